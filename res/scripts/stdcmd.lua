@@ -127,6 +127,42 @@ console.add_command(
     end
 )
 
+console.add_command(
+    "bench.lights x:num~pos.x z:num~pos.z iterations:int=16",
+    "Compare previous and current light solvers on chunk sky light rebuild",
+    function(args, kwargs)
+        local x, z, iterations = unpack(args)
+        local result = bench.lights(x, z, iterations)
+        return string.format(
+            "legacy: %.3fms, current: %.3fms (%d iterations)",
+            result.legacy / iterations / 1000,
+            result.current / iterations / 1000,
+            iterations
+        )
+    end
+)
+
+console.add_command(
+    "bench.codecs x:num~pos.x z:num~pos.z iterations:int=16",
+    "Compare region codecs on chunk voxels and lights",
+    function(args, kwargs)
+        local x, z, iterations = unpack(args)
+        local results = bench.codecs(x, z, iterations)
+        local lines = {}
+        for name, result in pairs(results) do
+            table.insert(lines, string.format(
+                "%s: %d bytes, encode: %.3fms, decode: %.3fms",
+                name,
+                result.size,
+                result.encode / iterations / 1000,
+                result.decode / iterations / 1000
+            ))
+        end
+        table.sort(lines)
+        return table.concat(lines, "\n")
+    end
+)
+
 console.add_command(
     "player.respawn player:sel=$obj.id",
     "Respawn player entity",
@@ -135,6 +135,24 @@ function events.emit(event, ...)
     return result
 end
 
+-- emits the event for every x, y, z triple of the arguments
+function events.emit_positions(event, ...)
+    local handlers = events.handlers[event]
+    if not handlers then
+        return
+    end
+    local args = {...}
+    for i=1, #args, 3 do
+        for _, func in ipairs(handlers) do
+            -- a failed call must not skip the rest of positions
+            local status, err = pcall(func, args[i], args[i + 1], args[i + 2])
+            if not status then
+                debug.error(err)
+            end
+        end
+    end
+end
+
 -- class designed for simple UI-nodes access via properties syntax
 local Element = {}
 function Element.new(docname, name)
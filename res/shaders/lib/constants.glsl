@@ -6,6 +6,8 @@
 
 // geometry
 #define CURVATURE_FACTOR 0.002
+// chunk vertex position fixed point scale
+#define CHUNK_POSITION_SCALE (1.0 / 64.0)
 
 // lighting
 #define SKY_LIGHT_MUL 2.5
@@ -0,0 +1,155 @@
+#include "lz.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+inline constexpr uint HASH_BITS = 14;
+inline constexpr uint WINDOW_SIZE = 1 << 16;
+inline constexpr uint WINDOW_MASK = WINDOW_SIZE - 1;
+/// @brief Max number of candidates checked per position
+inline constexpr uint MAX_CHAIN = 32;
+
+static inline uint32_t hash4(const ubyte* src) {
+    uint32_t value;
+    std::memcpy(&value, src, 4);
+    return (value * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static inline size_t write_varint(ubyte* dst, size_t offset, size_t value) {
+    while (value >= 0x80) {
+        dst[offset++] = static_cast<ubyte>(value) | 0x80;
+        value >>= 7;
+    }
+    dst[offset++] = static_cast<ubyte>(value);
+    return offset;
+}
+
+static inline size_t read_varint(
+    const ubyte* src, size_t srclen, size_t& offset
+) {
+    size_t value = 0;
+    for (uint shift = 0; shift < 64; shift += 7) {
+        if (offset >= srclen) {
+            break;
+        }
+        ubyte b = src[offset++];
+        value |= static_cast<size_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("lz: corrupted data");
+}
+
+/// @brief Hash chains reused by the encoder on the thread
+struct Chains {
+    std::vector<int32_t> heads;
+    std::vector<int32_t> prev;
+
+    Chains() : heads(1 << HASH_BITS), prev(WINDOW_SIZE) {
+    }
+
+    void reset() {
+        std::fill(heads.begin(), heads.end(), -1);
+    }
+
+    void insert(const ubyte* src, size_t pos) {
+        uint32_t hash = hash4(src + pos);
+        prev[pos & WINDOW_MASK] = heads[hash];
+        heads[hash] = static_cast<int32_t>(pos);
+    }
+};
+
+size_t lz::encode(const ubyte* src, size_t srclen, ubyte* dst) {
+    static thread_local Chains chains;
+    chains.reset();
+
+    size_t offset = 0;
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + min_match <= srclen) {
+        size_t bestLength = 0;
+        size_t bestOffset = 0;
+        int32_t candidate = chains.heads[hash4(src + pos)];
+        size_t maxLength = srclen - pos;
+        for (uint i = 0; i < MAX_CHAIN && candidate >= 0; i++) {
+            size_t distance = pos - candidate;
+            if (distance >= WINDOW_SIZE) {
+                break;
+            }
+            const ubyte* a = src + candidate;
+            const ubyte* b = src + pos;
+            if (a[bestLength] == b[bestLength]) {
+                size_t length = 0;
+                while (length < maxLength && a[length] == b[length]) {
+                    length++;
+                }
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestOffset = distance;
+                    if (length == maxLength) {
+                        break;
+                    }
+                }
+            }
+            candidate = chains.prev[candidate & WINDOW_MASK];
+        }
+        if (bestLength < min_match) {
+            chains.insert(src, pos++);
+            continue;
+        }
+        offset = write_varint(dst, offset, pos - anchor);
+        std::memcpy(dst + offset, src + anchor, pos - anchor);
+        offset += pos - anchor;
+        offset = write_varint(dst, offset, bestLength - min_match);
+        offset = write_varint(dst, offset, bestOffset);
+
+        size_t end = pos + bestLength;
+        for (; pos < end && pos + min_match <= srclen; pos++) {
+            chains.insert(src, pos);
+        }
+        pos = end;
+        anchor = end;
+    }
+    offset = write_varint(dst, offset, srclen - anchor);
+    std::memcpy(dst + offset, src + anchor, srclen - anchor);
+    return offset + srclen - anchor;
+}
+
+size_t lz::decode(const ubyte* src, size_t srclen, ubyte* dst, size_t dstlen) {
+    size_t offset = 0;
+    size_t pos = 0;
+    while (true) {
+        size_t literals = read_varint(src, srclen, offset);
+        if (literals > srclen - offset || literals > dstlen - pos) {
+            throw std::runtime_error("lz: corrupted data");
+        }
+        std::memcpy(dst + pos, src + offset, literals);
+        offset += literals;
+        pos += literals;
+        if (offset == srclen) {
+            return pos;
+        }
+        size_t length = read_varint(src, srclen, offset) + min_match;
+        size_t distance = read_varint(src, srclen, offset);
+        if (distance == 0 || distance > pos || length > dstlen - pos) {
+            throw std::runtime_error("lz: corrupted data");
+        }
+        ubyte* out = dst + pos;
+        if (distance == 1) {
+            std::memset(out, out[-1], length);
+        } else if (distance >= length) {
+            std::memcpy(out, out - distance, length);
+        } else {
+            // overlapping match repeats the last distance bytes
+            for (size_t i = 0; i < length; i += distance) {
+                std::memcpy(
+                    out + i, out + i - distance, std::min(distance, length - i)
+                );
+            }
+        }
+        pos += length;
+    }
+}
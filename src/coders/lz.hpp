@@ -0,0 +1,31 @@
+#ifndef CODERS_LZ_HPP_
+#define CODERS_LZ_HPP_
+
+#include <typedefs.hpp>
+
+/// @brief LZ77 byte codec with varint lengths and offsets.
+/// Encoded data is a sequence of [literals count][literals]
+/// [match length - lz::min_match][match offset] ending with literals.
+/// Long runs are encoded as matches with offset 1, so the codec is never
+/// much worse than RLE, while repeated patterns are compressed too
+namespace lz {
+    constexpr uint min_match = 4;
+
+    /// @brief Max length of encoded data. A match of min_match bytes
+    /// takes up to min_match + 1 bytes encoded (3 bytes of offset),
+    /// so the worst case is one extra byte per min_match source bytes
+    constexpr size_t max_encoded_size(size_t srclen) {
+        return srclen + srclen / min_match + 16;
+    }
+
+    /// @param dst destination buffer of max_encoded_size(srclen) length
+    /// @return encoded data length
+    size_t encode(const ubyte* src, size_t srclen, ubyte* dst);
+
+    /// @param dstlen destination buffer length
+    /// @return decoded data length
+    /// @throws std::runtime_error if data is corrupted or exceeds dstlen
+    size_t decode(const ubyte* src, size_t srclen, ubyte* dst, size_t dstlen);
+}
+
+#endif  // CODERS_LZ_HPP_
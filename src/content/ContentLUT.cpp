@@ -26,7 +26,12 @@ static constexpr size_t get_entries_count(
 std::shared_ptr<ContentLUT> ContentLUT::create(
     const fs::path& filename, const Content* content
 ) {
-    auto root = files::read_json(filename);
+    return create(files::read_json(filename), content);
+}
+
+std::shared_ptr<ContentLUT> ContentLUT::create(
+    const dynamic::Map_sptr& root, const Content* content
+) {
     auto blocklist = root->list("blocks");
     auto itemlist = root->list("items");
 
@@ -104,6 +104,12 @@ public:
         const fs::path& filename, const Content* content
     );
 
+    /// @param root indices map with 'blocks' and 'items' names lists
+    /// @return nullptr if no conversion is required
+    static std::shared_ptr<ContentLUT> create(
+        const dynamic::Map_sptr& root, const Content* content
+    );
+
     inline bool hasContentReorder() const {
         return blocks.hasContentReorder() || items.hasContentReorder();
     }
@@ -0,0 +1,57 @@
+#include "CodecBenchmark.hpp"
+
+#include <memory>
+
+#include <lighting/Lightmap.hpp>
+#include <util/timeutil.hpp>
+#include <voxels/Chunk.hpp>
+
+std::vector<files::CodecBenchmarkResult> files::benchmark_codecs(
+    const Chunk& chunk, uint iterations
+) {
+    auto target = std::make_unique<Chunk>(chunk.x, chunk.z);
+    auto voxelsBuffer = std::make_unique<ubyte[]>(CHUNK_DATA_LEN * 2);
+    auto lightsBuffer = std::make_unique<ubyte[]>(LIGHTMAP_DATA_LEN * 2);
+
+    std::vector<CodecBenchmarkResult> results;
+    for (uint i = 0; i < REGION_CODECS_COUNT; i++) {
+        auto codec = static_cast<RegionCodec>(i);
+        CodecBenchmarkResult result {codec, 0, 0, 0};
+        size_t voxelsSize = 0;
+        size_t lightsSize = 0;
+        for (uint n = 0; n < iterations; n++) {
+            timeutil::Timer encodeTimer;
+            auto voxels = chunk.encode();
+            voxelsSize = encode_chunk_data(
+                codec, voxels.get(), CHUNK_DATA_LEN, voxelsBuffer.get()
+            );
+            auto lights = chunk.lightmap.encode();
+            lightsSize = encode_chunk_data(
+                codec, lights.get(), LIGHTMAP_DATA_LEN, lightsBuffer.get()
+            );
+            result.encode += encodeTimer.stop();
+
+            timeutil::Timer decodeTimer;
+            decode_chunk_data(
+                codec,
+                voxelsBuffer.get(),
+                voxelsSize,
+                voxels.get(),
+                CHUNK_DATA_LEN
+            );
+            target->decode(voxels.get());
+            decode_chunk_data(
+                codec,
+                lightsBuffer.get(),
+                lightsSize,
+                lights.get(),
+                LIGHTMAP_DATA_LEN
+            );
+            target->lightmap.set(Lightmap::decode(lights.get()).get());
+            result.decode += decodeTimer.stop();
+        }
+        result.size = voxelsSize + lightsSize;
+        results.push_back(result);
+    }
+    return results;
+}
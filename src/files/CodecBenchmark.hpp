@@ -0,0 +1,30 @@
+#ifndef FILES_CODEC_BENCHMARK_HPP_
+#define FILES_CODEC_BENCHMARK_HPP_
+
+#include <vector>
+
+#include <typedefs.hpp>
+#include "WorldRegions.hpp"
+
+class Chunk;
+
+namespace files {
+    struct CodecBenchmarkResult {
+        RegionCodec codec;
+        /// @brief Encoded voxels and lights size in bytes
+        size_t size;
+        /// @brief Total encoding time in microseconds
+        int64_t encode;
+        /// @brief Total decoding time in microseconds
+        int64_t decode;
+    };
+
+    /// @brief Encode and decode chunk voxels and lights repeatedly with
+    /// every region codec, as it's done on chunk save and load
+    /// (including voxels byte planes split and merge)
+    std::vector<CodecBenchmarkResult> benchmark_codecs(
+        const Chunk& chunk, uint iterations
+    );
+}
+
+#endif  // FILES_CODEC_BENCHMARK_HPP_
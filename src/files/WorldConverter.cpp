@@ -13,6 +13,7 @@
 #include <util/ThreadPool.hpp>
 #include <voxels/Chunk.hpp>
 #include "WorldFiles.hpp"
+#include "WorldRemap.hpp"
 
 namespace fs = std::filesystem;
 
@@ -38,6 +39,7 @@ WorldConverter::WorldConverter(
 )
     : wfile(std::make_unique<WorldFiles>(folder)),
       lut(std::move(lut)),
+      remap(WorldRemap::read(wfile->getRegions().getRemapFile(), content)),
       content(content) {
     fs::path regionsFolder =
         wfile->getRegions().getRegionsFolder(REGION_LAYER_VOXELS);
@@ -55,6 +57,37 @@ WorldConverter::WorldConverter(
 WorldConverter::~WorldConverter() {
 }
 
+static void convert_player(const fs::path& file, const ContentLUT* lut) {
+    logger.info() << "converting player " << file.u8string();
+    auto map = files::read_json(file);
+    Player::convert(map.get(), lut);
+    files::write_json(file, map.get());
+}
+
+bool WorldConverter::startRemap(
+    const fs::path& folder,
+    const Content* content,
+    const std::shared_ptr<ContentLUT>& lut
+) {
+    WorldFiles wfile(folder);
+    auto& regions = wfile.getRegions();
+    fs::path remapFile = regions.getRemapFile();
+    if (fs::exists(remapFile)) {
+        return false;
+    }
+    logger.info() << "starting lazy world conversion";
+    WorldRemap remap(files::read_json(folder / fs::path("indices.json")), lut);
+    remap.addRegions(regions.getRegionsFolder(REGION_LAYER_VOXELS));
+    files::write_json(remapFile, remap.serialize().get(), false);
+
+    fs::path playerFile = wfile.getPlayerFile();
+    if (fs::is_regular_file(playerFile)) {
+        convert_player(playerFile, lut.get());
+    }
+    wfile.write(nullptr, content);
+    return true;
+}
+
 std::shared_ptr<Task> WorldConverter::startTask(
     const fs::path& folder,
     const Content* content,
@@ -97,19 +130,24 @@ void WorldConverter::convertRegion(const fs::path& file) const {
         return;
     }
     logger.info() << "converting region " << name;
-    wfile->getRegions().processRegionVoxels(x, z, [=](ubyte* data) {
-        if (lut) {
-            Chunk::convert(data, lut.get());
+    wfile->getRegions().processRegionVoxels(
+        x,
+        z,
+        [this](ubyte* data, int chunkX, int chunkZ) {
+            if (remap && remap->isPending(chunkX, chunkZ)) {
+                if (remap->getLUT()) {
+                    Chunk::convert(data, remap->getLUT().get());
+                }
+            } else if (lut) {
+                Chunk::convert(data, lut.get());
+            }
+            return true;
         }
-        return true;
-    });
+    );
 }
 
 void WorldConverter::convertPlayer(const fs::path& file) const {
-    logger.info() << "converting player " << file.u8string();
-    auto map = files::read_json(file);
-    Player::convert(map.get(), lut.get());
-    files::write_json(file, map.get());
+    convert_player(file, lut.get());
 }
 
 void WorldConverter::convert(const convert_task& task) const {
@@ -158,6 +196,11 @@ bool WorldConverter::isActive() const {
 void WorldConverter::write() {
     logger.info() << "writing world";
     wfile->write(nullptr, content);
+    // world may be opened right after conversion
+    wfile->getRegions().flush();
+    if (remap) {
+        fs::remove(wfile->getRegions().getRemapFile());
+    }
 }
 
 void WorldConverter::waitForEnd() {
@@ -14,6 +14,7 @@ namespace fs = std::filesystem;
 class Content;
 class ContentLUT;
 class WorldFiles;
+class WorldRemap;
 
 enum class convert_task_type { region, player };
 
@@ -25,6 +26,9 @@ struct convert_task {
 class WorldConverter : public Task {
     std::unique_ptr<WorldFiles> wfile;
     std::shared_ptr<ContentLUT> const lut;
+    /// @brief Unfinished lazy conversion: pending chunks are saved with
+    /// other indices than the rest
+    std::unique_ptr<WorldRemap> remap;
     const Content* const content;
     std::queue<convert_task> tasks;
     runnable onComplete;
@@ -52,6 +56,15 @@ public:
     uint getWorkTotal() const override;
     uint getWorkDone() const override;
 
+    /// @brief Start lazy conversion: chunks will be converted when loaded.
+    /// Player is converted and world indices are replaced immediately
+    /// @return false if the previous lazy conversion is not finished
+    static bool startRemap(
+        const fs::path& folder,
+        const Content* content,
+        const std::shared_ptr<ContentLUT>& lut
+    );
+
     static std::shared_ptr<Task> startTask(
         const fs::path& folder,
         const Content* content,
@@ -1,23 +1,124 @@
 #include "WorldRegions.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <utility>
 #include <vector>
 
 #include <coders/byte_utils.hpp>
+#include <coders/lz.hpp>
 #include <coders/rle.hpp>
+#include <content/ContentLUT.hpp>
 #include <data/dynamic.hpp>
+#include <debug/Logger.hpp>
 #include <items/Inventory.hpp>
 #include <maths/voxmaths.hpp>
 #include <util/data_io.hpp>
+#include "WorldRemap.hpp"
 
 #define REGION_FORMAT_MAGIC ".VOXREG"
 
+static debug::Logger logger("world-regions");
+
+// compression buffers are twice as large as the chunk data
+static_assert(lz::max_encoded_size(CHUNK_DATA_LEN) <= CHUNK_DATA_LEN * 2);
+static_assert(
+    lz::max_encoded_size(LIGHTMAP_DATA_LEN) <= LIGHTMAP_DATA_LEN * 2
+);
+
+size_t encode_chunk_data(
+    RegionCodec codec, const ubyte* src, size_t srclen, ubyte* dst
+) {
+    switch (codec) {
+        case RegionCodec::extrle:
+            return extrle::encode(src, srclen, dst);
+        case RegionCodec::lz:
+            return lz::encode(src, srclen, dst);
+    }
+    throw std::runtime_error("unknown region codec");
+}
+
+void decode_chunk_data(
+    RegionCodec codec,
+    const ubyte* src,
+    size_t srclen,
+    ubyte* dst,
+    size_t dstlen
+) {
+    switch (codec) {
+        case RegionCodec::extrle:
+            extrle::decode(src, srclen, dst);
+            return;
+        case RegionCodec::lz:
+            if (lz::decode(src, srclen, dst, dstlen) != dstlen) {
+                throw std::runtime_error("lz: unexpected data length");
+            }
+            return;
+    }
+    throw std::runtime_error("unknown region codec");
+}
+
+const char* to_string(RegionCodec codec) {
+    switch (codec) {
+        case RegionCodec::extrle:
+            return "extrle";
+        case RegionCodec::lz:
+            return "lz";
+    }
+    return "unknown";
+}
+
+/// @brief FNV-1a hash of the offsets table slot excluding the checksum
+static uint32_t slot_checksum(const ubyte* slot) {
+    uint32_t hash = 2166136261U;
+    for (uint i = 0; i < REGION_TABLE_SLOT_SIZE; i++) {
+        if (i == 4) {
+            i += 3;
+            continue;
+        }
+        hash = (hash ^ slot[i]) * 16777619U;
+    }
+    return hash;
+}
+
+static void write_table_slot(
+    ubyte* dst,
+    uint32_t generation,
+    const uint32_t* offsets,
+    const uint32_t* sizes
+) {
+    dataio::write_int32_big(generation, dst, 0);
+    ubyte* table = dst + 8;
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        dataio::write_int32_big(offsets[i], table, i * 8);
+        dataio::write_int32_big(sizes[i], table, i * 8 + 4);
+    }
+    dataio::write_int32_big(slot_checksum(dst), dst, 4);
+}
+
+/// @return false if the slot is damaged
+static bool read_table_slot(
+    const ubyte* src,
+    uint32_t& generation,
+    uint32_t* offsets,
+    uint32_t* sizes
+) {
+    if (uint32_t(dataio::read_int32_big(src, 4)) != slot_checksum(src)) {
+        return false;
+    }
+    generation = dataio::read_int32_big(src, 0);
+    const ubyte* table = src + 8;
+    for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        offsets[i] = dataio::read_int32_big(table, i * 8);
+        sizes[i] = dataio::read_int32_big(table, i * 8 + 4);
+    }
+    return true;
+}
+
 regfile::regfile(fs::path filename) : file(std::move(filename)) {
     if (file.length() < REGION_HEADER_SIZE)
         throw std::runtime_error("incomplete region file header");
-    char header[REGION_HEADER_SIZE];
-    file.read(header, REGION_HEADER_SIZE);
+    const auto header = reinterpret_cast<const char*>(file.data());
 
     // avoid of use strcmp_s
     if (std::string(header, strlen(REGION_FORMAT_MAGIC)) !=
@@ -30,45 +131,100 @@ regfile::regfile(fs::path filename) : file(std::move(filename)) {
             "region format " + std::to_string(version) + " is not supported"
         );
     }
+    codec = RegionCodec::extrle;
+    if (version >= 3) {
+        if (ubyte(header[9]) >= REGION_CODECS_COUNT) {
+            throw illegal_region_format("unknown region codec");
+        }
+        codec = static_cast<RegionCodec>(header[9]);
+    }
+    const ubyte* bytes = file.data();
+    size_t dataEnd;
+    if (version >= 4) {
+        dataEnd = file.length();
+        if (dataEnd < REGION_TABLE_OFFSET + REGION_TABLE_SLOT_SIZE * 2) {
+            throw illegal_region_format("incomplete region file offsets table");
+        }
+        auto readSlot = [this, bytes](int index) {
+            const ubyte* src =
+                bytes + REGION_TABLE_OFFSET + index * REGION_TABLE_SLOT_SIZE;
+            return read_table_slot(src, generation, offsets, sizes);
+        };
+        slot = header[REGION_SLOT_FLAG] & 1;
+        // selected slot is always complete unless the flag is damaged
+        if (!readSlot(slot)) {
+            slot = 1 - slot;
+            if (!readSlot(slot)) {
+                throw illegal_region_format(
+                    "region file offsets table is damaged"
+                );
+            }
+        }
+    } else if (version == 3) {
+        dataEnd = file.length();
+        if (dataEnd < REGION_TABLE_OFFSET + REGION_TABLE_SIZE) {
+            throw illegal_region_format("incomplete region file offsets table");
+        }
+        const ubyte* table = bytes + REGION_TABLE_OFFSET;
+        for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+            offsets[i] = dataio::read_int32_big(table, i * 8);
+            sizes[i] = dataio::read_int32_big(table, i * 8 + 4);
+        }
+    } else {
+        // offsets table is at the file end, chunk size precedes its data
+        const size_t tableSize = REGION_CHUNKS_COUNT * 4;
+        if (file.length() < REGION_HEADER_SIZE + tableSize) {
+            throw illegal_region_format("incomplete region file offsets table");
+        }
+        dataEnd = file.length() - tableSize;
+        const ubyte* table = bytes + dataEnd;
+        for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+            uint32_t offset = dataio::read_int32_big(table, i * 4);
+            sizes[i] = 0;
+            offsets[i] = 0;
+            if (offset == 0) {
+                continue;
+            }
+            if (offset + 4ULL > dataEnd) {
+                throw illegal_region_format(
+                    "chunk offset is out of region file"
+                );
+            }
+            sizes[i] = dataio::read_int32_big(bytes, offset);
+            offsets[i] = offset + 4;
+        }
+    }
+    for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        if (offsets[i] && offsets[i] + uint64_t(sizes[i]) > dataEnd) {
+            throw illegal_region_format("chunk data is out of region file");
+        }
+    }
 }
 
-std::unique_ptr<ubyte[]> regfile::read(int index, uint32_t& length) {
-    size_t file_size = file.length();
-    size_t table_offset = file_size - REGION_CHUNKS_COUNT * 4;
-
-    uint32_t offset;
-    file.seekg(table_offset + index * 4);
-    file.read(reinterpret_cast<char*>(&offset), 4);
-    offset = dataio::read_int32_big(reinterpret_cast<const ubyte*>(&offset), 0);
-    if (offset == 0) {
+std::unique_ptr<ubyte[]> regfile::read(int index, uint32_t& length) const {
+    if (offsets[index] == 0) {
         return nullptr;
     }
-
-    file.seekg(offset);
-    file.read(reinterpret_cast<char*>(&offset), 4);
-    length = dataio::read_int32_big(reinterpret_cast<const ubyte*>(&offset), 0);
+    length = sizes[index];
     auto data = std::make_unique<ubyte[]>(length);
-    file.read(reinterpret_cast<char*>(data.get()), length);
+    std::memcpy(data.get(), file.data() + offsets[index], length);
     return data;
 }
 
 WorldRegion::WorldRegion()
     : chunksData(
-          std::make_unique<std::unique_ptr<ubyte[]>[]>(REGION_CHUNKS_COUNT)
+          std::make_unique<std::shared_ptr<ubyte[]>[]>(REGION_CHUNKS_COUNT)
       ),
       sizes(std::make_unique<uint32_t[]>(REGION_CHUNKS_COUNT)) {
 }
 
 WorldRegion::~WorldRegion() = default;
 
-void WorldRegion::setUnsaved(bool unsaved) {
-    this->unsaved = unsaved;
-}
 bool WorldRegion::isUnsaved() const {
-    return unsaved;
+    return unsaved.any();
 }
 
-std::unique_ptr<ubyte[]>* WorldRegion::getChunks() const {
+std::shared_ptr<ubyte[]>* WorldRegion::getChunks() const {
     return chunksData.get();
 }
 
@@ -80,10 +236,34 @@ void WorldRegion::put(uint x, uint z, ubyte* data, uint32_t size) {
     size_t chunk_index = z * REGION_SIZE + x;
     chunksData[chunk_index].reset(data);
     sizes[chunk_index] = size;
+    unsaved.set(chunk_index);
+}
+
+std::unique_ptr<WorldRegion> WorldRegion::takeUnsaved() {
+    auto region = std::make_unique<WorldRegion>();
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        if (unsaved.test(i)) {
+            region->chunksData[i] = chunksData[i];
+            region->sizes[i] = sizes[i];
+        }
+    }
+    region->unsaved = unsaved;
+    return region;
+}
+
+void WorldRegion::release(const WorldRegion& written) {
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        // chunks put again have new data
+        if (written.unsaved.test(i) &&
+            chunksData[i] == written.chunksData[i]) {
+            chunksData[i].reset();
+            unsaved.reset(i);
+        }
+    }
 }
 
-ubyte* WorldRegion::getChunkData(uint x, uint z) {
-    return chunksData[z * REGION_SIZE + x].get();
+std::shared_ptr<ubyte[]> WorldRegion::getChunkData(uint x, uint z) {
+    return chunksData[z * REGION_SIZE + x];
 }
 
 uint WorldRegion::getChunkDataSize(uint x, uint z) {
@@ -99,9 +279,21 @@ WorldRegions::WorldRegions(const fs::path& directory) : directory(directory) {
     layers[REGION_LAYER_INVENTORIES].folder =
         directory / fs::path("inventories");
     layers[REGION_LAYER_ENTITIES].folder = directory / fs::path("entities");
+
+    layers[REGION_LAYER_VOXELS].codec = RegionCodec::lz;
+    layers[REGION_LAYER_VOXELS].dataLength = CHUNK_DATA_LEN;
+    layers[REGION_LAYER_LIGHTS].codec = RegionCodec::lz;
+    layers[REGION_LAYER_LIGHTS].dataLength = LIGHTMAP_DATA_LEN;
 }
 
-WorldRegions::~WorldRegions() = default;
+WorldRegions::~WorldRegions() {
+    stopRemapJobs();
+    try {
+        flush();
+    } catch (const std::exception& err) {
+        logger.error() << "unsaved regions are lost: " << err.what();
+    }
+}
 
 WorldRegion* WorldRegions::getRegion(int x, int z, int layer) {
     RegionsLayer& regions = layers[layer];
@@ -113,51 +305,28 @@ WorldRegion* WorldRegions::getRegion(int x, int z, int layer) {
     return found->second.get();
 }
 
-WorldRegion* WorldRegions::getOrCreateRegion(int x, int z, int layer) {
-    if (auto region = getRegion(x, z, layer)) {
-        return region;
-    }
-    RegionsLayer& regions = layers[layer];
-    std::lock_guard lock(regions.mutex);
-    auto region_ptr = std::make_unique<WorldRegion>();
-    auto region = region_ptr.get();
-    regions.regions[{x, z}] = std::move(region_ptr);
-    return region;
-}
-
 std::unique_ptr<ubyte[]> WorldRegions::compress(
-    const ubyte* src, size_t srclen, size_t& len
+    const ubyte* src, size_t srclen, size_t& len, RegionCodec codec
 ) {
     auto buffer = bufferPool.get();
     auto bytes = buffer.get();
 
-    len = extrle::encode(src, srclen, bytes);
+    len = encode_chunk_data(codec, src, srclen, bytes);
     auto data = std::make_unique<ubyte[]>(len);
-    for (size_t i = 0; i < len; i++) {
-        data[i] = bytes[i];
-    }
+    std::memcpy(data.get(), bytes, len);
     return data;
 }
 
 std::unique_ptr<ubyte[]> WorldRegions::decompress(
-    const ubyte* src, size_t srclen, size_t dstlen
+    const ubyte* src, size_t srclen, size_t dstlen, RegionCodec codec
 ) {
     auto decompressed = std::make_unique<ubyte[]>(dstlen);
-    extrle::decode(src, srclen, decompressed.get());
+    decode_chunk_data(codec, src, srclen, decompressed.get(), dstlen);
     return decompressed;
 }
 
-inline void calc_reg_coords(
-    int x, int z, int& regionX, int& regionZ, int& localX, int& localZ
-) {
-    regionX = floordiv(x, REGION_SIZE);
-    regionZ = floordiv(z, REGION_SIZE);
-    localX = x - (regionX * REGION_SIZE);
-    localZ = z - (regionZ * REGION_SIZE);
-}
-
 std::unique_ptr<ubyte[]> WorldRegions::readChunkData(
-    int x, int z, uint32_t& length, regfile* rfile
+    int x, int z, uint32_t& length, const regfile* rfile
 ) {
     int regionX, regionZ, localX, localZ;
     calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
@@ -165,70 +334,161 @@ std::unique_ptr<ubyte[]> WorldRegions::readChunkData(
     return rfile->read(chunkIndex, length);
 }
 
-/// @brief Read missing chunks data (null pointers) from region file
 void WorldRegions::fetchChunks(
-    WorldRegion* region, int x, int z, regfile* file
+    WorldRegion* region, int x, int z, int layer, const regfile* file
 ) {
     auto* chunks = region->getChunks();
     uint32_t* sizes = region->getSizes();
+    const auto& regions = layers[layer];
+    bool recode = regions.dataLength && file->codec != regions.codec;
 
     for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
         int chunk_x = (i % REGION_SIZE) + x * REGION_SIZE;
         int chunk_z = (i / REGION_SIZE) + z * REGION_SIZE;
-        if (chunks[i] == nullptr) {
-            chunks[i] = readChunkData(chunk_x, chunk_z, sizes[i], file);
+        if (chunks[i] != nullptr) {
+            continue;
+        }
+        auto data = readChunkData(chunk_x, chunk_z, sizes[i], file);
+        if (data && recode) {
+            data = decompress(
+                data.get(), sizes[i], regions.dataLength, file->codec
+            );
+            size_t size;
+            data = compress(
+                data.get(), regions.dataLength, size, regions.codec
+            );
+            sizes[i] = size;
         }
+        chunks[i] = std::move(data);
     }
 }
 
-ubyte* WorldRegions::getData(int x, int z, int layer, uint32_t& size) {
+std::shared_ptr<ubyte[]> WorldRegions::getData(
+    int x, int z, int layer, uint32_t& size, RegionCodec& codec
+) {
     if (generatorTestMode) {
         return nullptr;
     }
     int regionX, regionZ, localX, localZ;
     calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
 
-    WorldRegion* region = getOrCreateRegion(regionX, regionZ, layer);
-    ubyte* data = region->getChunkData(localX, localZ);
-    if (data == nullptr) {
-        auto regfile = getRegFile(glm::ivec3(regionX, regionZ, layer));
-        if (regfile != nullptr) {
-            data = readChunkData(x, z, size, regfile.get()).release();
-        }
-        if (data != nullptr) {
-            region->put(localX, localZ, data, size);
+    waitForCompression(x, z, layer);
+
+    {
+        RegionsLayer& regions = layers[layer];
+        std::lock_guard lock(regions.mutex);
+        const auto found = regions.regions.find(glm::ivec2(regionX, regionZ));
+        if (found != regions.regions.end()) {
+            auto& region = found->second;
+            if (auto data = region->getChunkData(localX, localZ)) {
+                size = region->getChunkDataSize(localX, localZ);
+                codec = regions.codec;
+                return data;
+            }
         }
     }
-    if (data != nullptr) {
-        size = region->getChunkDataSize(localX, localZ);
-        return data;
+    auto regfile = getRegFile(glm::ivec3(regionX, regionZ, layer));
+    if (regfile == nullptr) {
+        return nullptr;
     }
-    return nullptr;
+    codec = regfile->codec;
+    return readChunkData(x, z, size, regfile.get());
 }
 
-regfile_ptr WorldRegions::useRegFile(glm::ivec3 coord) {
-    auto* file = openRegFiles[coord].get();
-    file->inUse = true;
-    return regfile_ptr(file, &regFilesCv);
+void WorldRegions::putData(
+    int x, int z, int layer, std::unique_ptr<ubyte[]> data, size_t size
+) {
+    int regionX, regionZ, localX, localZ;
+    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
+
+    RegionsLayer& regions = layers[layer];
+    std::lock_guard lock(regions.mutex);
+    auto& region = regions.regions[glm::ivec2(regionX, regionZ)];
+    if (region == nullptr) {
+        region = std::make_unique<WorldRegion>();
+    }
+    region->put(localX, localZ, data.release(), size);
 }
 
-void WorldRegions::closeRegFile(glm::ivec3 coord) {
-    openRegFiles.erase(coord);
-    regFilesCv.notify_one();
+void WorldRegions::putAsync(
+    int x, int z, int layer, std::unique_ptr<ubyte[]> data, size_t size
+) {
+    glm::ivec3 key(x, z, layer);
+    std::shared_ptr<ubyte[]> source(data.release());
+
+    // lock is held until the job is registered,
+    // so the job can not unregister itself earlier
+    std::lock_guard lock(compressionsMutex);
+    uint64_t id = ++compressionsCounter;
+    auto job = [=]() {
+        size_t compressedSize;
+        auto compressed = compress(
+            source.get(), size, compressedSize, layers[layer].codec
+        );
+        putData(x, z, layer, std::move(compressed), compressedSize);
+
+        std::lock_guard lock(compressionsMutex);
+        const auto found = compressions.find(key);
+        if (found != compressions.end() && found->second.id == id) {
+            compressions.erase(found);
+        }
+    };
+    auto& jobSystem = util::JobSystem::getInstance();
+    auto& entry = compressions[key];
+    entry.job =
+        entry.job ? jobSystem.then(entry.job, job) : jobSystem.submit(job);
+    entry.id = id;
 }
 
-// Marks regfile as used and unmarks when shared_ptr dies
-regfile_ptr WorldRegions::getRegFile(glm::ivec3 coord, bool create) {
+void WorldRegions::waitForCompression(int x, int z, int layer) {
+    util::JobHandle job;
     {
-        std::lock_guard lock(regFilesMutex);
-        const auto found = openRegFiles.find(coord);
-        if (found != openRegFiles.end()) {
-            if (found->second->inUse) {
-                throw std::runtime_error("regfile is currently in use");
-            }
-            return useRegFile(found->first);
+        std::lock_guard lock(compressionsMutex);
+        const auto found = compressions.find(glm::ivec3(x, z, layer));
+        if (found == compressions.end()) {
+            return;
+        }
+        job = found->second.job;
+    }
+    util::JobSystem::getInstance().wait(job);
+}
+
+void WorldRegions::waitForCompressions() {
+    std::vector<util::JobHandle> jobs;
+    {
+        std::lock_guard lock(compressionsMutex);
+        for (const auto& [key, entry] : compressions) {
+            jobs.push_back(entry.job);
         }
     }
+    auto& jobSystem = util::JobSystem::getInstance();
+    for (const auto& job : jobs) {
+        jobSystem.wait(job);
+    }
+}
+
+void WorldRegions::closeRegFile(glm::ivec3 coord) {
+    const auto found = openRegFiles.find(coord);
+    if (found == openRegFiles.end()) {
+        return;
+    }
+    regFilesLRU.erase(found->second.lruPosition);
+    openRegFiles.erase(found);
+}
+
+regfile_ptr WorldRegions::getRegFile(glm::ivec3 coord, bool create) {
+    std::unique_lock lock(regFilesMutex);
+    regFilesCondition.wait(lock, [this, coord]() {
+        return writtenRegFiles.find(coord) == writtenRegFiles.end();
+    });
+    const auto found = openRegFiles.find(coord);
+    if (found != openRegFiles.end()) {
+        auto& entry = found->second;
+        regFilesLRU.splice(
+            regFilesLRU.begin(), regFilesLRU, entry.lruPosition
+        );
+        return entry.file;
+    }
     if (create) {
         return createRegFile(coord);
     }
@@ -241,95 +501,207 @@ regfile_ptr WorldRegions::createRegFile(glm::ivec3 coord) {
     if (!fs::exists(file)) {
         return nullptr;
     }
-    if (openRegFiles.size() == MAX_OPEN_REGION_FILES) {
-        std::unique_lock lock(regFilesMutex);
-        while (true) {
-            bool closed = false;
-            // FIXME: bad choosing algorithm
-            for (auto& entry : openRegFiles) {
-                if (!entry.second->inUse) {
-                    closeRegFile(entry.first);
-                    closed = true;
-                    break;
-                }
-            }
-            if (closed) {
-                break;
-            }
-            // notified when any regfile gets out of use or closed
-            regFilesCv.wait(lock);
-        }
-        openRegFiles[coord] = std::make_unique<regfile>(file);
-        return useRegFile(coord);
-    } else {
-        std::lock_guard lock(regFilesMutex);
-        openRegFiles[coord] = std::make_unique<regfile>(file);
-        return useRegFile(coord);
+    while (openRegFiles.size() >= MAX_OPEN_REGION_FILES) {
+        closeRegFile(regFilesLRU.back());
     }
+    // writer waits for the last mapping holder before rewriting the file
+    regfile_ptr opened(new regfile(file), [this](const regfile* mapped) {
+        delete mapped;
+        {
+            std::lock_guard lock(mappingsMutex);
+        }
+        mappingsCondition.notify_all();
+    });
+    regFilesLRU.push_front(coord);
+    openRegFiles[coord] = regfile_entry {opened, regFilesLRU.begin()};
+    return opened;
 }
 
 fs::path WorldRegions::getRegionFilename(int x, int z) const {
     return fs::path(std::to_string(x) + "_" + std::to_string(z) + ".bin");
 }
 
-void WorldRegions::writeRegion(int x, int z, int layer, WorldRegion* entry) {
-    fs::path filename = layers[layer].folder / getRegionFilename(x, z);
+/// @brief Find a run of free sectors, extending the file if there is none.
+/// First sectors are always used by the header and offsets table
+/// @return index of the first allocated sector
+static uint allocate_sectors(std::vector<bool>& sectors, uint count) {
+    uint run = 0;
+    uint index = REGION_DATA_SECTOR;
+    for (; index < sectors.size() && run < count; index++) {
+        run = sectors[index] ? 0 : run + 1;
+    }
+    // free sectors at the end of the file are used too
+    uint start = index - run;
+    if (sectors.size() < start + count) {
+        sectors.resize(start + count, false);
+    }
+    std::fill(sectors.begin() + start, sectors.begin() + start + count, true);
+    return start;
+}
 
-    glm::ivec3 regcoord(x, z, layer);
-    if (auto regfile = getRegFile(regcoord, false)) {
-        fetchChunks(entry, x, z, regfile.get());
+static uint sectors_count(uint32_t size) {
+    return std::max(1u, (size + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE);
+}
 
+void WorldRegions::writeRegion(int x, int z, int layer, WorldRegion* entry) {
+    glm::ivec3 regcoord(x, z, layer);
+    std::weak_ptr<const regfile> mapped;
+    {
+        // loader threads must not open the region file while it's written
         std::lock_guard lock(regFilesMutex);
-        regfile.reset();
-        closeRegFile(regcoord);
+        writtenRegFiles.insert(regcoord);
+        const auto found = openRegFiles.find(regcoord);
+        if (found != openRegFiles.end()) {
+            mapped = found->second.file;
+            closeRegFile(regcoord);
+        }
     }
+    auto finish = [this, regcoord]() {
+        {
+            std::lock_guard lock(regFilesMutex);
+            writtenRegFiles.erase(regcoord);
+        }
+        regFilesCondition.notify_all();
+    };
+    {
+        // readers still copying chunks from the previous mapping
+        std::unique_lock lock(mappingsMutex);
+        mappingsCondition.wait(lock, [&mapped]() { return mapped.expired(); });
+    }
+    try {
+        writeRegionFile(x, z, layer, entry);
+    } catch (...) {
+        finish();
+        throw;
+    }
+    finish();
+}
 
-    char header[REGION_HEADER_SIZE] = REGION_FORMAT_MAGIC;
-    header[8] = REGION_FORMAT_VERSION;
-    header[9] = 0;  // flags
-    std::ofstream file(filename, std::ios::out | std::ios::binary);
-    file.write(header, REGION_HEADER_SIZE);
+void WorldRegions::writeRegionFile(
+    int x, int z, int layer, WorldRegion* entry
+) {
+    fs::path filename = layers[layer].folder / getRegionFilename(x, z);
 
-    size_t offset = REGION_HEADER_SIZE;
-    char intbuf[4] {};
-    uint offsets[REGION_CHUNKS_COUNT] {};
+    uint32_t offsets[REGION_CHUNKS_COUNT] {};
+    uint32_t sizes[REGION_CHUNKS_COUNT] {};
+    std::vector<bool> sectors(REGION_DATA_SECTOR, true);
+    const auto& regions = layers[layer];
+    bool rewrite = true;
+    int slot = 0;
+    uint32_t generation = 0;
+    if (fs::exists(filename)) {
+        regfile current(filename);
+        if (current.version < 4 ||
+            (regions.dataLength && current.codec != regions.codec)) {
+            // previous formats are not sector-aligned, all chunks must
+            // use the same codec
+            fetchChunks(entry, x, z, layer, &current);
+        } else {
+            rewrite = false;
+            slot = current.slot;
+            generation = current.generation;
+            for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+                offsets[i] = current.offsets[i];
+                sizes[i] = current.sizes[i];
+                if (offsets[i] == 0) {
+                    continue;
+                }
+                uint start = offsets[i] / REGION_SECTOR_SIZE;
+                uint end = start + sectors_count(sizes[i]);
+                if (sectors.size() < end) {
+                    sectors.resize(end, false);
+                }
+                std::fill(sectors.begin() + start, sectors.begin() + end, true);
+            }
+        }
+    }
+    if (rewrite) {
+        std::vector<ubyte> head(REGION_DATA_SECTOR * REGION_SECTOR_SIZE);
+        std::memcpy(
+            head.data(), REGION_FORMAT_MAGIC, strlen(REGION_FORMAT_MAGIC)
+        );
+        head[8] = REGION_FORMAT_VERSION;
+        head[9] = static_cast<ubyte>(regions.codec);  // flags
+        head[REGION_SLOT_FLAG] = slot;
+        // empty table in the active slot, the other one is invalid
+        uint32_t empty[REGION_CHUNKS_COUNT] {};
+        write_table_slot(
+            head.data() + REGION_TABLE_OFFSET, generation, empty, empty
+        );
+        std::ofstream file(filename, std::ios::out | std::ios::binary);
+        file.write(reinterpret_cast<const char*>(head.data()), head.size());
+    }
+    std::fstream file(
+        filename, std::ios::in | std::ios::out | std::ios::binary
+    );
+    if (!file.is_open()) {
+        throw std::runtime_error("could not open file " + filename.string());
+    }
 
     auto* region = entry->getChunks();
-    uint32_t* sizes = entry->getSizes();
+    uint32_t* regionSizes = entry->getSizes();
 
+    // chunks are written to free sectors, previously used sectors get
+    // free only when the table is updated
+    std::vector<char> padding(REGION_SECTOR_SIZE);
     for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        ubyte* chunk = region[i].get();
+        const ubyte* chunk = region[i].get();
         if (chunk == nullptr) {
-            offsets[i] = 0;
-        } else {
-            offsets[i] = offset;
+            continue;
+        }
+        uint32_t size = regionSizes[i];
+        uint count = sectors_count(size);
+        uint start = allocate_sectors(sectors, count);
 
-            size_t compressedSize = sizes[i];
-            dataio::write_int32_big(
-                compressedSize, reinterpret_cast<ubyte*>(intbuf), 0
+        file.seekp(size_t(start) * REGION_SECTOR_SIZE);
+        file.write(reinterpret_cast<const char*>(chunk), size);
+        file.write(padding.data(), count * REGION_SECTOR_SIZE - size);
+        offsets[i] = start * REGION_SECTOR_SIZE;
+        sizes[i] = size;
+    }
+    // chunks data must be on the disk before the table pointing to it,
+    // then the table before the slot flag
+    auto sync = [&file, &filename]() {
+        file.flush();
+        if (!file || !files::sync(filename)) {
+            throw std::runtime_error(
+                "could not write file " + filename.string()
             );
-            offset += 4 + compressedSize;
-
-            file.write(intbuf, 4);
-            file.write(reinterpret_cast<const char*>(chunk), compressedSize);
         }
-    }
-    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        dataio::write_int32_big(
-            offsets[i], reinterpret_cast<ubyte*>(intbuf), 0
-        );
-        file.write(intbuf, 4);
-    }
+    };
+    sync();
+
+    int nextSlot = 1 - slot;
+    auto slotData = std::make_unique<ubyte[]>(REGION_TABLE_SLOT_SIZE);
+    write_table_slot(slotData.get(), generation + 1, offsets, sizes);
+    file.seekp(REGION_TABLE_OFFSET + nextSlot * REGION_TABLE_SLOT_SIZE);
+    file.write(
+        reinterpret_cast<const char*>(slotData.get()), REGION_TABLE_SLOT_SIZE
+    );
+    sync();
+
+    file.seekp(REGION_SLOT_FLAG);
+    file.put(static_cast<char>(nextSlot));
+    sync();
 }
 
 void WorldRegions::writeRegions(int layer) {
-    for (auto& it : layers[layer].regions) {
-        WorldRegion* region = it.second.get();
-        if (region->getChunks() == nullptr || !region->isUnsaved()) {
-            continue;
+    std::vector<std::pair<glm::ivec2, std::unique_ptr<WorldRegion>>> regions;
+    {
+        std::lock_guard lock(layers[layer].mutex);
+        for (auto& [key, region] : layers[layer].regions) {
+            if (!region->isUnsaved()) {
+                continue;
+            }
+            regions.emplace_back(key, region->takeUnsaved());
         }
-        glm::ivec2 key = it.first;
-        writeRegion(key[0], key[1], layer, region);
+    }
+    for (auto& [key, region] : regions) {
+        writeRegion(key[0], key[1], layer, region.get());
+
+        // written chunks are read from the file since now
+        std::lock_guard lock(layers[layer].mutex);
+        layers[layer].regions.at(key)->release(*region);
     }
 }
 
@@ -343,16 +715,12 @@ void WorldRegions::put(
 ) {
     if (rle) {
         size_t compressedSize;
-        auto compressed = compress(data.get(), size, compressedSize);
+        auto compressed =
+            compress(data.get(), size, compressedSize, layers[layer].codec);
         put(x, z, layer, std::move(compressed), compressedSize, false);
         return;
     }
-    int regionX, regionZ, localX, localZ;
-    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
-
-    WorldRegion* region = getOrCreateRegion(regionX, regionZ, layer);
-    region->setUnsaved(true);
-    region->put(localX, localZ, data.release(), size);
+    putData(x, z, layer, std::move(data), size);
 }
 
 static std::unique_ptr<ubyte[]> write_inventories(
@@ -389,21 +757,19 @@ void WorldRegions::put(Chunk* chunk, std::vector<ubyte> entitiesData) {
     int regionX, regionZ, localX, localZ;
     calc_reg_coords(chunk->x, chunk->z, regionX, regionZ, localX, localZ);
 
-    put(chunk->x,
-        chunk->z,
-        REGION_LAYER_VOXELS,
-        chunk->encode(),
-        CHUNK_DATA_LEN,
-        true);
+    putAsync(
+        chunk->x, chunk->z, REGION_LAYER_VOXELS, chunk->encode(), CHUNK_DATA_LEN
+    );
 
     // Writing lights cache
     if (doWriteLights && chunk->flags.lighted) {
-        put(chunk->x,
+        putAsync(
+            chunk->x,
             chunk->z,
             REGION_LAYER_LIGHTS,
             chunk->lightmap.encode(),
-            LIGHTMAP_DATA_LEN,
-            true);
+            LIGHTMAP_DATA_LEN
+        );
     }
     // Writing block inventories
     if (!chunk->inventories.empty()) {
@@ -431,35 +797,68 @@ void WorldRegions::put(Chunk* chunk, std::vector<ubyte> entitiesData) {
     }
 }
 
-std::unique_ptr<ubyte[]> WorldRegions::getChunk(int x, int z) {
+std::unique_ptr<ubyte[]> WorldRegions::readChunk(int x, int z) {
     uint32_t size;
-    auto* data = getData(x, z, REGION_LAYER_VOXELS, size);
+    RegionCodec codec;
+    auto data = getData(x, z, REGION_LAYER_VOXELS, size, codec);
     if (data == nullptr) {
         return nullptr;
     }
-    return decompress(data, size, CHUNK_DATA_LEN);
+    return decompress(data.get(), size, CHUNK_DATA_LEN, codec);
+}
+
+std::unique_ptr<ubyte[]> WorldRegions::getChunk(int x, int z) {
+    if (remap && remap->isPending(x, z)) {
+        return getRemappedChunk(x, z);
+    }
+    return readChunk(x, z);
+}
+
+std::unique_ptr<ubyte[]> WorldRegions::getRemappedChunk(int x, int z) {
+    std::lock_guard lock(remapMutex);
+    auto data = readChunk(x, z);
+    // may be converted by another thread meanwhile
+    if (!remap->isPending(x, z)) {
+        return data;
+    }
+    if (data && remap->getLUT()) {
+        Chunk::convert(data.get(), remap->getLUT().get());
+        auto converted = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
+        std::memcpy(converted.get(), data.get(), CHUNK_DATA_LEN);
+        put(x,
+            z,
+            REGION_LAYER_VOXELS,
+            std::move(converted),
+            CHUNK_DATA_LEN,
+            true);
+    }
+    // chunks missing in the region are generated with current indices
+    remap->setConverted(x, z);
+    return data;
 }
 
 /// @brief Get cached lights for chunk at x,z
 /// @return lights data or nullptr
 std::unique_ptr<light_t[]> WorldRegions::getLights(int x, int z) {
     uint32_t size;
-    auto* bytes = getData(x, z, REGION_LAYER_LIGHTS, size);
+    RegionCodec codec;
+    auto bytes = getData(x, z, REGION_LAYER_LIGHTS, size, codec);
     if (bytes == nullptr) {
         return nullptr;
     }
-    auto data = decompress(bytes, size, LIGHTMAP_DATA_LEN);
+    auto data = decompress(bytes.get(), size, LIGHTMAP_DATA_LEN, codec);
     return Lightmap::decode(data.get());
 }
 
 chunk_inventories_map WorldRegions::fetchInventories(int x, int z) {
     chunk_inventories_map meta;
     uint32_t bytesSize;
-    const ubyte* data = getData(x, z, REGION_LAYER_INVENTORIES, bytesSize);
+    RegionCodec codec;
+    auto data = getData(x, z, REGION_LAYER_INVENTORIES, bytesSize, codec);
     if (data == nullptr) {
         return meta;
     }
-    ByteReader reader(data, bytesSize);
+    ByteReader reader(data.get(), bytesSize);
     auto count = reader.getInt32();
     for (int i = 0; i < count; i++) {
         uint index = reader.getInt32();
@@ -475,11 +874,12 @@ chunk_inventories_map WorldRegions::fetchInventories(int x, int z) {
 
 dynamic::Map_sptr WorldRegions::fetchEntities(int x, int z) {
     uint32_t bytesSize;
-    const ubyte* data = getData(x, z, REGION_LAYER_ENTITIES, bytesSize);
+    RegionCodec codec;
+    auto data = getData(x, z, REGION_LAYER_ENTITIES, bytesSize, codec);
     if (data == nullptr) {
         return nullptr;
     }
-    auto map = json::from_binary(data, bytesSize);
+    auto map = json::from_binary(data.get(), bytesSize);
     if (map->size() == 0) {
         return nullptr;
     }
@@ -503,8 +903,10 @@ void WorldRegions::processRegionVoxels(int x, int z, const regionproc& func) {
             if (data == nullptr) {
                 continue;
             }
-            data = decompress(data.get(), length, CHUNK_DATA_LEN);
-            if (func(data.get())) {
+            data = decompress(
+                data.get(), length, CHUNK_DATA_LEN, regfile->codec
+            );
+            if (func(data.get(), gx, gz)) {
                 put(gx,
                     gz,
                     REGION_LAYER_VOXELS,
@@ -520,10 +922,123 @@ fs::path WorldRegions::getRegionsFolder(int layer) const {
     return layers[layer].folder;
 }
 
+fs::path WorldRegions::getRemapFile() const {
+    return directory / fs::path("remap.json");
+}
+
+void WorldRegions::setRemap(std::unique_ptr<WorldRemap> remap) {
+    this->remap = std::move(remap);
+}
+
+void WorldRegions::convergeRemap() {
+    if (remap == nullptr || remap->isDone()) {
+        return;
+    }
+    std::lock_guard lock(remapJobMutex);
+    remapJob = util::JobSystem::getInstance().submit(
+        [this]() { convergeRemapRegion(); }, util::JobPriority::low
+    );
+}
+
+void WorldRegions::convergeRemapRegion() {
+    auto pending = remap->getPendingRegions();
+    if (pending.empty()) {
+        return;
+    }
+    glm::ivec2 region = pending.front();
+    for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        if (remapStopped) {
+            return;
+        }
+        int x = region.x * REGION_SIZE + i % REGION_SIZE;
+        int z = region.y * REGION_SIZE + i / REGION_SIZE;
+        if (remap->isPending(x, z)) {
+            getRemappedChunk(x, z);
+        }
+    }
+    std::lock_guard lock(remapJobMutex);
+    if (!remapStopped) {
+        remapJob = util::JobSystem::getInstance().submit(
+            [this]() { convergeRemapRegion(); }, util::JobPriority::low
+        );
+    }
+}
+
+void WorldRegions::stopRemapJobs() {
+    remapStopped = true;
+    auto& jobSystem = util::JobSystem::getInstance();
+    while (true) {
+        util::JobHandle job;
+        {
+            std::lock_guard lock(remapJobMutex);
+            job = remapJob;
+        }
+        if (job == nullptr) {
+            return;
+        }
+        jobSystem.wait(job);
+        // the job may have submitted the next one before stop
+        std::lock_guard lock(remapJobMutex);
+        if (remapJob == job) {
+            return;
+        }
+    }
+}
+
 void WorldRegions::write() {
     for (auto& layer : layers) {
         fs::create_directories(layer.folder);
-        writeRegions(layer.layer);
+    }
+    auto job = [this]() {
+        try {
+            waitForCompressions();
+            dynamic::Map_sptr remapState;
+            for (auto& layer : layers) {
+                if (remap && layer.layer == REGION_LAYER_VOXELS) {
+                    // written voxels must match the written remap state
+                    std::lock_guard lock(remapMutex);
+                    writeRegions(layer.layer);
+                    remapState = remap->serialize();
+                } else {
+                    writeRegions(layer.layer);
+                }
+            }
+            if (remapState == nullptr) {
+                return;
+            }
+            if (remapState->list("regions")->size() == 0) {
+                fs::remove(getRemapFile());
+            } else {
+                files::write_json(getRemapFile(), remapState.get(), false);
+            }
+        } catch (const std::exception& err) {
+            // unsaved chunks are written again with the next job
+            logger.error() << "could not write regions: " << err.what();
+            std::lock_guard lock(writeErrorMutex);
+            if (writeError == nullptr) {
+                writeError = std::current_exception();
+            }
+        }
+    };
+    auto& jobSystem = util::JobSystem::getInstance();
+    auto priority = util::JobPriority::low;
+    writeJob = writeJob ? jobSystem.then(writeJob, job, priority)
+                        : jobSystem.submit(job, priority);
+}
+
+void WorldRegions::flush() {
+    if (writeJob) {
+        util::JobSystem::getInstance().wait(writeJob);
+    }
+    waitForCompressions();
+
+    std::exception_ptr error;
+    {
+        std::lock_guard lock(writeErrorMutex);
+        std::swap(error, writeError);
+    }
+    if (error) {
+        std::rethrow_exception(error);
     }
 }
 
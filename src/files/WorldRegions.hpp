@@ -1,17 +1,24 @@
 #ifndef FILES_WORLD_REGIONS_HPP_
 #define FILES_WORLD_REGIONS_HPP_
 
+#include <atomic>
+#include <bitset>
 #include <condition_variable>
+#include <exception>
 #include <filesystem>
 #include <functional>
 #include <glm/glm.hpp>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <data/dynamic_fwd.hpp>
+#include <maths/voxmaths.hpp>
 #include <typedefs.hpp>
 #include <util/BufferPool.hpp>
+#include <util/JobSystem.hpp>
 #include <voxels/Chunk.hpp>
 #include "files.hpp"
 #define GLM_ENABLE_EXPERIMENTAL
@@ -29,8 +36,69 @@ inline constexpr uint REGION_LAYER_ENTITIES = 3;
 inline constexpr uint REGION_SIZE_BIT = 5;
 inline constexpr uint REGION_SIZE = (1 << (REGION_SIZE_BIT));
 inline constexpr uint REGION_CHUNKS_COUNT = ((REGION_SIZE) * (REGION_SIZE));
-inline constexpr uint REGION_FORMAT_VERSION = 2;
-inline constexpr uint MAX_OPEN_REGION_FILES = 16;
+inline constexpr uint REGION_FORMAT_VERSION = 4;
+/// @brief Chunks data allocation unit since region format 3
+inline constexpr uint REGION_SECTOR_SIZE = 512;
+/// @brief Offsets table position since region format 3.
+/// Table entry is a pair of big-endian int32: data offset and size
+inline constexpr uint REGION_TABLE_OFFSET = 16;
+inline constexpr uint REGION_TABLE_SIZE = REGION_CHUNKS_COUNT * 8;
+/// @brief Header byte selecting the active offsets table slot since
+/// region format 4
+inline constexpr uint REGION_SLOT_FLAG = 10;
+/// @brief Offsets table slot since region format 4: big-endian int32
+/// generation and checksum followed by the table. Two slots follow each
+/// other since REGION_TABLE_OFFSET, the inactive one is overwritten
+/// and then selected, so the active table is never written in place
+inline constexpr uint REGION_TABLE_SLOT_SIZE = 8 + REGION_TABLE_SIZE;
+/// @brief Index of the first sector available for chunks data
+inline constexpr uint REGION_DATA_SECTOR =
+    (REGION_TABLE_OFFSET + REGION_TABLE_SLOT_SIZE * 2 + REGION_SECTOR_SIZE -
+     1) /
+    REGION_SECTOR_SIZE;
+/// @brief Max number of region files mapped at once, enough to cover
+/// the default loading area on every layer
+inline constexpr uint MAX_OPEN_REGION_FILES = 64;
+
+inline void calc_reg_coords(
+    int x, int z, int& regionX, int& regionZ, int& localX, int& localZ
+) {
+    regionX = floordiv(x, REGION_SIZE);
+    regionZ = floordiv(z, REGION_SIZE);
+    localX = x - (regionX * REGION_SIZE);
+    localZ = z - (regionZ * REGION_SIZE);
+}
+
+/// @brief Compression of chunks data in region files. Codec id is stored
+/// in the region file header flags byte
+enum class RegionCodec : ubyte {
+    /// @brief extended RLE, the only codec of region formats 1 and 2
+    extrle = 0,
+    /// @brief LZ77, see coders/lz.hpp
+    lz = 1,
+};
+
+inline constexpr uint REGION_CODECS_COUNT = 2;
+
+/// @brief Encode chunk data with the codec
+/// @param dst destination buffer of 2 * srclen length at least
+/// @return encoded data length
+size_t encode_chunk_data(
+    RegionCodec codec, const ubyte* src, size_t srclen, ubyte* dst
+);
+
+/// @brief Decode chunk data with the codec
+/// @param dstlen decoded data length
+/// @throws std::runtime_error if data is corrupted
+void decode_chunk_data(
+    RegionCodec codec,
+    const ubyte* src,
+    size_t srclen,
+    ubyte* dst,
+    size_t dstlen
+);
+
+const char* to_string(RegionCodec codec);
 
 class illegal_region_format : public std::runtime_error {
 public:
@@ -39,135 +107,221 @@ public:
     }
 };
 
+/// @brief In-memory chunks data of a region, which is not written yet.
+/// Saved chunks are read from the region file
 class WorldRegion {
-    std::unique_ptr<std::unique_ptr<ubyte[]>[]> chunksData;
+    std::unique_ptr<std::shared_ptr<ubyte[]>[]> chunksData;
     std::unique_ptr<uint32_t[]> sizes;
-    bool unsaved = false;
+    std::bitset<REGION_CHUNKS_COUNT> unsaved;
 public:
     WorldRegion();
     ~WorldRegion();
 
+    /// @brief Put chunk data marking it unsaved
     void put(uint x, uint z, ubyte* data, uint32_t size);
-    ubyte* getChunkData(uint x, uint z);
+    std::shared_ptr<ubyte[]> getChunkData(uint x, uint z);
     uint getChunkDataSize(uint x, uint z);
 
-    void setUnsaved(bool unsaved);
     bool isUnsaved() const;
 
-    std::unique_ptr<ubyte[]>* getChunks() const;
+    std::shared_ptr<ubyte[]>* getChunks() const;
     uint32_t* getSizes() const;
+
+    /// @brief Create region sharing data of unsaved chunks only.
+    /// Chunks stay unsaved until released, so failed writes are retried
+    std::unique_ptr<WorldRegion> takeUnsaved();
+
+    /// @brief Mark chunks written from the region taken with takeUnsaved
+    /// saved and release their data, unless the chunks were put again
+    void release(const WorldRegion& written);
 };
 
+/// @brief Memory-mapped region file. Offsets table is parsed on open,
+/// reading is thread-safe, so one regfile is shared by all readers
 struct regfile {
-    files::rafile file;
+    files::mmapfile file;
     int version;
-    bool inUse = false;
+    RegionCodec codec;
+    /// @brief Active offsets table slot and its generation
+    int slot = 0;
+    uint32_t generation = 0;
+    /// @brief Chunks data offsets, 0 if chunk is not stored
+    uint32_t offsets[REGION_CHUNKS_COUNT];
+    uint32_t sizes[REGION_CHUNKS_COUNT];
 
     regfile(fs::path filename);
     regfile(const regfile&) = delete;
 
-    std::unique_ptr<ubyte[]> read(int index, uint32_t& length);
+    /// @brief Copy chunk data from the mapping
+    /// @return nullptr if the chunk is not stored in the file
+    std::unique_ptr<ubyte[]> read(int index, uint32_t& length) const;
 };
 
+using regfile_ptr = std::shared_ptr<const regfile>;
+
 using regionsmap = std::unordered_map<glm::ivec2, std::unique_ptr<WorldRegion>>;
-using regionproc = std::function<bool(ubyte*)>;
+/// @brief Chunk data processor, returns true if data is modified
+using regionproc = std::function<bool(ubyte* data, int x, int z)>;
+
+class WorldRemap;
 
 struct RegionsLayer {
     int layer;
     fs::path folder;
+    /// @brief Codec of the layer chunks data, files using another codec
+    /// are converted when written
+    RegionCodec codec = RegionCodec::extrle;
+    /// @brief Decoded chunk data length, 0 if the layer is not compressed
+    size_t dataLength = 0;
     regionsmap regions;
+    /// @brief guards regions map and regions data
     std::mutex mutex;
 };
 
-class regfile_ptr {
-    regfile* file;
-    std::condition_variable* cv;
-public:
-    regfile_ptr(regfile* file, std::condition_variable* cv)
-        : file(file), cv(cv) {
-    }
-
-    regfile_ptr(const regfile_ptr&) = delete;
-
-    regfile_ptr(std::nullptr_t) : file(nullptr), cv(nullptr) {
-    }
+struct pending_compression {
+    util::JobHandle job;
+    uint64_t id;
+};
 
-    bool operator==(std::nullptr_t) const {
-        return file == nullptr;
-    }
-    bool operator!=(std::nullptr_t) const {
-        return file != nullptr;
-    }
-    operator bool() const {
-        return file != nullptr;
-    }
-    ~regfile_ptr() {
-        reset();
-    }
-    regfile* get() {
-        return file;
-    }
-    void reset() {
-        if (file) {
-            file->inUse = false;
-            cv->notify_one();
-            file = nullptr;
-        }
-    }
+struct regfile_entry {
+    regfile_ptr file;
+    std::list<glm::ivec3>::iterator lruPosition;
 };
 
 class WorldRegions {
     fs::path directory;
-    std::unordered_map<glm::ivec3, std::unique_ptr<regfile>> openRegFiles;
+    /// @brief Notified when a shared region file mapping is released.
+    /// Declared before open files to outlive them
+    std::mutex mappingsMutex;
+    std::condition_variable mappingsCondition;
+    std::unordered_map<glm::ivec3, regfile_entry> openRegFiles;
+    /// @brief Open region files coords, most recently used first
+    std::list<glm::ivec3> regFilesLRU;
+    /// @brief guards open region files, their LRU list and written
+    /// region files set
     std::mutex regFilesMutex;
-    std::condition_variable regFilesCv;
+    /// @brief Region files being written, not opened until written
+    std::unordered_set<glm::ivec3> writtenRegFiles;
+    /// @brief Notified when a region file writing is finished
+    std::condition_variable regFilesCondition;
     RegionsLayer layers[4] {};
     util::BufferPool<ubyte> bufferPool {
         std::max(CHUNK_DATA_LEN, LIGHTMAP_DATA_LEN) * 2};
+    /// @brief Latest compression job of chunk layer data by (x, z, layer).
+    /// Jobs of the same chunk layer are chained to keep order
+    std::unordered_map<glm::ivec3, pending_compression> compressions;
+    std::mutex compressionsMutex;
+    uint64_t compressionsCounter = 0;
+    /// @brief Last region files writing job
+    util::JobHandle writeJob;
+    /// @brief First error of writing jobs since the last flush
+    std::exception_ptr writeError;
+    std::mutex writeErrorMutex;
+    /// @brief Lazy conversion of chunks saved with previous content indices
+    std::unique_ptr<WorldRemap> remap;
+    /// @brief Guards pending chunks conversion. Held while voxels regions
+    /// are captured to be written with the matching remap state
+    std::mutex remapMutex;
+    /// @brief Current background conversion job
+    util::JobHandle remapJob;
+    std::mutex remapJobMutex;
+    std::atomic<bool> remapStopped = false;
 
     WorldRegion* getRegion(int x, int z, int layer);
-    WorldRegion* getOrCreateRegion(int x, int z, int layer);
 
-    /// @brief Compress buffer with extrle
+    /// @brief Compress buffer with the codec
     /// @param src source buffer
     /// @param srclen length of the source buffer
     /// @param len (out argument) length of result buffer
     /// @return compressed bytes array
     std::unique_ptr<ubyte[]> compress(
-        const ubyte* src, size_t srclen, size_t& len
+        const ubyte* src, size_t srclen, size_t& len, RegionCodec codec
     );
 
-    /// @brief Decompress buffer with extrle
+    /// @brief Decompress buffer with the codec
     /// @param src compressed buffer
     /// @param srclen length of compressed buffer
-    /// @param dstlen max expected length of source buffer
+    /// @param dstlen length of source buffer
     /// @return decompressed bytes array
     std::unique_ptr<ubyte[]> decompress(
-        const ubyte* src, size_t srclen, size_t dstlen
+        const ubyte* src, size_t srclen, size_t dstlen, RegionCodec codec
     );
 
     std::unique_ptr<ubyte[]> readChunkData(
-        int x, int y, uint32_t& length, regfile* file
+        int x, int y, uint32_t& length, const regfile* file
+    );
+
+    /// @brief Read missing chunks data (null pointers) from region file
+    /// converting it to the layer codec
+    void fetchChunks(
+        WorldRegion* region, int x, int y, int layer, const regfile* file
+    );
+
+    /// @brief Get unsaved chunk data or read it from the region file
+    /// @param codec (out argument) codec of the data
+    std::shared_ptr<ubyte[]> getData(
+        int x, int z, int layer, uint32_t& size, RegionCodec& codec
     );
 
-    void fetchChunks(WorldRegion* region, int x, int y, regfile* file);
+    std::unique_ptr<ubyte[]> readChunk(int x, int z);
+
+    /// @brief Get chunk converting it to the current content indices
+    /// if it is pending
+    std::unique_ptr<ubyte[]> getRemappedChunk(int x, int z);
 
-    ubyte* getData(int x, int z, int layer, uint32_t& size);
+    /// @brief Convert pending chunks of a region and submit the next job
+    void convergeRemapRegion();
+    void stopRemapJobs();
 
+    /// @brief Store data in region (thread-safe)
+    void putData(
+        int x, int z, int layer, std::unique_ptr<ubyte[]> data, size_t size
+    );
+
+    /// @brief Compress data with extrle in background, then store it
+    /// in region
+    void putAsync(
+        int x, int z, int layer, std::unique_ptr<ubyte[]> data, size_t size
+    );
+
+    /// @brief Wait for chunk layer data compression if it's in work
+    void waitForCompression(int x, int z, int layer);
+    void waitForCompressions();
+
+    /// @brief Get shared region file, opening it if not open yet.
+    /// Waits if the file is being written
+    /// @return nullptr if the file does not exist or create is false
+    /// and the file is not open
     regfile_ptr getRegFile(glm::ivec3 coord, bool create = true);
+    /// @brief Forget the region file (regFilesMutex must be locked).
+    /// Mapping is released when the last reader drops it
     void closeRegFile(glm::ivec3 coord);
-    regfile_ptr useRegFile(glm::ivec3 coord);
+    /// @brief Open region file evicting the least recently used one
+    /// if limit is reached (regFilesMutex must be locked)
     regfile_ptr createRegFile(glm::ivec3 coord);
 
     fs::path getRegionFilename(int x, int y) const;
 
+    /// @brief Write unsaved regions of the layer. Regions are captured
+    /// under the layer lock, so chunks may be put while files are written
+    /// @throws std::runtime_error if a region file could not be written,
+    /// not written regions stay unsaved
     void writeRegions(int layer);
 
-    /// @brief Write or rewrite region file
+    /// @brief Close the region file and write it. Other region files
+    /// are available while it's written
     /// @param x region X
     /// @param z region Z
     /// @param layer regions layer
+    /// @param entry unsaved chunks
     void writeRegion(int x, int y, int layer, WorldRegion* entry);
+
+    /// @brief Write region chunks to free sectors of the closed region
+    /// file, then write offsets table to the inactive slot and select it.
+    /// Every step is synchronized with the disk before the next one, so
+    /// the file is consistent after a crash. Files of older formats are
+    /// rewritten
+    void writeRegionFile(int x, int z, int layer, WorldRegion* entry);
 public:
     bool generatorTestMode = false;
     bool doWriteLights = true;
@@ -176,7 +330,8 @@ public:
     WorldRegions(const WorldRegions&) = delete;
     ~WorldRegions();
 
-    /// @brief Put all chunk data to regions
+    /// @brief Put all chunk data to regions. Voxels and lights are
+    /// compressed in background
     void put(Chunk* chunk, std::vector<ubyte> entitiesData);
 
     /// @brief Store data in specified region
@@ -185,7 +340,7 @@ public:
     /// @param layer regions layer
     /// @param data target data
     /// @param size data size
-    /// @param rle compress with ext-RLE
+    /// @param rle compress with the layer codec
     void put(
         int x,
         int z,
@@ -195,6 +350,8 @@ public:
         bool rle
     );
 
+    /// @brief Get chunk voxels data. Chunks saved with previous content
+    /// indices are converted
     std::unique_ptr<ubyte[]> getChunk(int x, int z);
     std::unique_ptr<light_t[]> getLights(int x, int z);
     chunk_inventories_map fetchInventories(int x, int z);
@@ -204,8 +361,29 @@ public:
 
     fs::path getRegionsFolder(int layer) const;
 
+    /// @brief Get lazy conversion state file, written with regions
+    fs::path getRemapFile() const;
+
+    void setRemap(std::unique_ptr<WorldRemap> remap);
+
+    /// @return lazy conversion state or nullptr
+    WorldRemap* getRemap() const {
+        return remap.get();
+    }
+
+    /// @brief Start converting all pending chunks in background,
+    /// region by region. Converted regions stay in memory until written
+    void convergeRemap();
+
+    /// @brief Start writing unsaved regions in background after pending
+    /// compressions
     void write();
 
+    /// @brief Wait for pending compressions and regions writing
+    /// @throws std::runtime_error if regions writing failed since
+    /// the last flush
+    void flush();
+
     /// @brief Extract X and Z from 'X_Z.bin' region file name.
     /// @param name source region file name
     /// @param x parsed X destination
@@ -0,0 +1,165 @@
+#include "WorldRemap.hpp"
+
+#include <content/ContentLUT.hpp>
+#include <data/dynamic.hpp>
+#include <debug/Logger.hpp>
+#include "files.hpp"
+
+static debug::Logger logger("world-remap");
+
+WorldRemap::WorldRemap(
+    dynamic::Map_sptr indices, std::shared_ptr<ContentLUT> lut
+)
+    : indices(std::move(indices)), lut(std::move(lut)) {
+}
+
+WorldRemap::~WorldRemap() = default;
+
+void WorldRemap::addRegions(const fs::path& folder) {
+    if (!fs::is_directory(folder)) {
+        return;
+    }
+    std::lock_guard lock(mutex);
+    for (const auto& file : fs::directory_iterator(folder)) {
+        int x, z;
+        std::string name = file.path().stem().string();
+        if (!WorldRegions::parseRegionFilename(name, x, z)) {
+            logger.error() << "could not parse name " << name;
+            continue;
+        }
+        regions[glm::ivec2(x, z)] = {};
+    }
+}
+
+bool WorldRemap::isPending(int x, int z) const {
+    int regionX, regionZ, localX, localZ;
+    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
+
+    std::lock_guard lock(mutex);
+    const auto& found = regions.find(glm::ivec2(regionX, regionZ));
+    if (found == regions.end()) {
+        return false;
+    }
+    return !found->second.test(localZ * REGION_SIZE + localX);
+}
+
+void WorldRemap::setConverted(int x, int z) {
+    int regionX, regionZ, localX, localZ;
+    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
+
+    std::lock_guard lock(mutex);
+    const auto& found = regions.find(glm::ivec2(regionX, regionZ));
+    if (found == regions.end()) {
+        return;
+    }
+    found->second.set(localZ * REGION_SIZE + localX);
+    if (found->second.all()) {
+        regions.erase(found);
+    }
+}
+
+bool WorldRemap::isDone() const {
+    std::lock_guard lock(mutex);
+    return regions.empty();
+}
+
+std::vector<glm::ivec2> WorldRemap::getPendingRegions() const {
+    std::lock_guard lock(mutex);
+    std::vector<glm::ivec2> pending;
+    for (const auto& [pos, _] : regions) {
+        pending.push_back(pos);
+    }
+    return pending;
+}
+
+dynamic::Map_sptr WorldRemap::serialize() const {
+    auto root = dynamic::create_map();
+    if (auto blocks = indices->list("blocks")) {
+        root->put("blocks", blocks);
+    }
+    if (auto items = indices->list("items")) {
+        root->put("items", items);
+    }
+    auto& regionsList = root->putList("regions");
+
+    std::lock_guard lock(mutex);
+    for (const auto& [pos, converted] : regions) {
+        auto& regionMap = regionsList.putMap();
+        regionMap.put("x", pos.x);
+        regionMap.put("z", pos.y);
+        auto& convertedList = regionMap.putList("converted");
+        for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+            if (converted.test(i)) {
+                convertedList.put(static_cast<integer_t>(i));
+            }
+        }
+    }
+    return root;
+}
+
+template <typename T>
+static const T* get_value(const dynamic::Map& map, const std::string& key) {
+    auto found = map.values.find(key);
+    if (found == map.values.end()) {
+        return nullptr;
+    }
+    return std::get_if<T>(&found->second);
+}
+
+static void read_region(
+    const dynamic::Map& regionMap, std::bitset<REGION_CHUNKS_COUNT>& converted
+) {
+    auto convertedList = get_value<dynamic::List_sptr>(regionMap, "converted");
+    if (convertedList == nullptr || *convertedList == nullptr) {
+        throw std::runtime_error("region entry has no 'converted' list");
+    }
+    for (const auto& value : (*convertedList)->values) {
+        auto index = std::get_if<integer_t>(&value);
+        if (index == nullptr) {
+            throw std::runtime_error("converted chunk index is not an integer");
+        }
+        if (*index < 0 || *index >= REGION_CHUNKS_COUNT) {
+            throw std::runtime_error(
+                "converted chunk index " + std::to_string(*index) +
+                " is out of range"
+            );
+        }
+        converted.set(*index);
+    }
+}
+
+std::unique_ptr<WorldRemap> WorldRemap::read(
+    const fs::path& file, const Content* content
+) {
+    if (!fs::is_regular_file(file)) {
+        return nullptr;
+    }
+    try {
+        auto root = files::read_json(file);
+        auto remap = std::make_unique<WorldRemap>(
+            root, ContentLUT::create(root, content)
+        );
+        auto regionsList = get_value<dynamic::List_sptr>(*root, "regions");
+        if (regionsList == nullptr || *regionsList == nullptr) {
+            return remap;
+        }
+        for (const auto& value : (*regionsList)->values) {
+            auto regionMap = std::get_if<dynamic::Map_sptr>(&value);
+            if (regionMap == nullptr || *regionMap == nullptr) {
+                throw std::runtime_error("region entry is not an object");
+            }
+            auto x = get_value<integer_t>(**regionMap, "x");
+            auto z = get_value<integer_t>(**regionMap, "z");
+            if (x == nullptr || z == nullptr) {
+                throw std::runtime_error("region entry has no x, z position");
+            }
+            glm::ivec2 pos(*x, *z);
+            read_region(**regionMap, remap->regions[pos]);
+        }
+        return remap;
+    } catch (const std::runtime_error& err) {
+        throw std::runtime_error(
+            "invalid remap file " + file.u8string() + ": " + err.what()
+        );
+    }
+}
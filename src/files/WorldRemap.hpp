@@ -0,0 +1,66 @@
+#ifndef FILES_WORLD_REMAP_HPP_
+#define FILES_WORLD_REMAP_HPP_
+
+#include <bitset>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <data/dynamic_fwd.hpp>
+#include <typedefs.hpp>
+#include "WorldRegions.hpp"
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+namespace fs = std::filesystem;
+
+class Content;
+class ContentLUT;
+
+/// @brief State of the lazy world conversion. Chunks saved with previous
+/// content indices are converted when loaded instead of converting the
+/// whole world at once.
+/// Previous indices are stored to build the LUT against current content
+class WorldRemap {
+    /// @brief Content indices the pending chunks are saved with
+    dynamic::Map_sptr indices;
+    std::shared_ptr<ContentLUT> lut;
+    /// @brief Regions having pending chunks with bits of converted ones
+    std::unordered_map<glm::ivec2, std::bitset<REGION_CHUNKS_COUNT>> regions;
+    mutable std::mutex mutex;
+public:
+    WorldRemap(dynamic::Map_sptr indices, std::shared_ptr<ContentLUT> lut);
+    ~WorldRemap();
+
+    /// @brief Mark all chunks of the region files pending
+    /// @param folder voxels regions folder
+    void addRegions(const fs::path& folder);
+
+    /// @brief Check if the chunk is saved with previous indices
+    bool isPending(int x, int z) const;
+
+    void setConverted(int x, int z);
+
+    /// @brief Check if there is no pending chunks left
+    bool isDone() const;
+
+    std::vector<glm::ivec2> getPendingRegions() const;
+
+    /// @return lookup table or nullptr if previous indices match content
+    const std::shared_ptr<ContentLUT>& getLUT() const {
+        return lut;
+    }
+
+    dynamic::Map_sptr serialize() const;
+
+    /// @return nullptr if the file does not exist
+    /// @throws std::runtime_error if the file is malformed
+    static std::unique_ptr<WorldRemap> read(
+        const fs::path& file, const Content* content
+    );
+};
+
+#endif  // FILES_WORLD_REMAP_HPP_
@@ -14,6 +14,15 @@
 #include <data/dynamic.hpp>
 #include <util/stringutil.hpp>
 
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace fs = std::filesystem;
 
 files::rafile::rafile(const fs::path& filename)
@@ -37,6 +46,119 @@ void files::rafile::read(char* buffer, std::streamsize size) {
     file.read(buffer, size);
 }
 
+#ifdef _WIN32
+files::mmapfile::mmapfile(const fs::path& filename) {
+    HANDLE file = CreateFileW(
+        filename.wstring().c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("could not to open file " + filename.string());
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error("could not stat file " + filename.string());
+    }
+    fileHandle = file;
+    filelength = static_cast<size_t>(size.QuadPart);
+    if (filelength == 0) {
+        // empty files can not be mapped
+        return;
+    }
+    mappingHandle =
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle) {
+        bytes = static_cast<const ubyte*>(
+            MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0)
+        );
+    }
+    if (bytes == nullptr) {
+        if (mappingHandle) {
+            CloseHandle(mappingHandle);
+        }
+        CloseHandle(file);
+        throw std::runtime_error("could not map file " + filename.string());
+    }
+}
+
+files::mmapfile::~mmapfile() {
+    if (bytes) {
+        UnmapViewOfFile(bytes);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle) {
+        CloseHandle(fileHandle);
+    }
+}
+
+bool files::sync(const fs::path& filename) {
+    HANDLE file = CreateFileW(
+        filename.wstring().c_str(),
+        GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    bool done = FlushFileBuffers(file);
+    CloseHandle(file);
+    return done;
+}
+#else
+files::mmapfile::mmapfile(const fs::path& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("could not to open file " + filename.string());
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        throw std::runtime_error("could not stat file " + filename.string());
+    }
+    filelength = static_cast<size_t>(st.st_size);
+    if (filelength == 0) {
+        // empty files can not be mapped
+        close(fd);
+        return;
+    }
+    void* ptr = mmap(nullptr, filelength, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file referenced
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        throw std::runtime_error("could not map file " + filename.string());
+    }
+    bytes = static_cast<const ubyte*>(ptr);
+}
+
+files::mmapfile::~mmapfile() {
+    if (bytes) {
+        munmap(const_cast<ubyte*>(bytes), filelength);
+    }
+}
+
+bool files::sync(const fs::path& filename) {
+    int fd = open(filename.c_str(), O_RDWR);
+    if (fd == -1) {
+        return false;
+    }
+    bool done = fsync(fd) == 0;
+    close(fd);
+    return done;
+}
+#endif
+
 bool files::write_bytes(
     const fs::path& filename, const ubyte* data, size_t size
 ) {
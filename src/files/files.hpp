@@ -28,6 +28,34 @@ namespace files {
         size_t length() const;
     };
 
+    /// @brief Read-only memory-mapped file. Mapped bytes may be read
+    /// from any number of threads; the file must not be modified while
+    /// mapped
+    class mmapfile {
+        const ubyte* bytes = nullptr;
+        size_t filelength = 0;
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#endif
+    public:
+        mmapfile(const fs::path& filename);
+        mmapfile(const mmapfile&) = delete;
+        ~mmapfile();
+
+        const ubyte* data() const {
+            return bytes;
+        }
+
+        size_t length() const {
+            return filelength;
+        }
+    };
+
+    /// @brief Write written data of the file to the storage device
+    /// @return false if the file could not be synchronized
+    bool sync(const fs::path& filename);
+
     /// @brief Write bytes array to the file without any extra data
     /// @param file target file
     /// @param data data bytes array
@@ -63,12 +63,17 @@ SettingsHandler::SettingsHandler(EngineSettings& settings) {
     builder.add("load-distance", &settings.chunks.loadDistance);
     builder.add("load-speed", &settings.chunks.loadSpeed);
     builder.add("padding", &settings.chunks.padding);
+    builder.add("resident-memory", &settings.chunks.residentMemory);
+    builder.add("block-updates", &settings.chunks.blockUpdates);
+    builder.add("lazy-remap", &settings.chunks.lazyRemap);
+    builder.add("remap-in-background", &settings.chunks.remapInBackground);
 
     builder.section("graphics");
     builder.add("fog-curve", &settings.graphics.fogCurve);
     builder.add("backlight", &settings.graphics.backlight);
     builder.add("gamma", &settings.graphics.gamma);
     builder.add("frustum-culling", &settings.graphics.frustumCulling);
+    builder.add("greedy-meshing", &settings.graphics.greedyMeshing);
     builder.add("skybox-resolution", &settings.graphics.skyboxResolution);
 
     builder.section("ui");
@@ -18,6 +18,7 @@
 #include <voxels/Block.hpp>
 #include <voxels/Chunk.hpp>
 #include <voxels/Chunks.hpp>
+#include <voxels/ChunksStorage.hpp>
 #include <world/Level.hpp>
 #include <world/World.hpp>
 
@@ -87,6 +88,12 @@ std::shared_ptr<UINode> create_debug_panel(
         return L"chunks: "+std::to_wstring(level->chunks->chunksCount)+
                L" visible: "+std::to_wstring(level->chunks->visible);
     }));
+    panel->add(create_label([=]() {
+        auto storage = level->chunksStorage.get();
+        return L"resident chunks: "+
+               std::to_wstring(storage->getResidentCount())+L" ("+
+               std::to_wstring(storage->getResidentBytes() >> 20)+L" MiB)";
+    }));
     panel->add(create_label([=]() {
         return L"entities: "+std::to_wstring(level->entities->size())+L" next: "+
                std::to_wstring(level->entities->peekNextID());
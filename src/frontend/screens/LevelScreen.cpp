@@ -46,6 +46,9 @@ LevelScreen::LevelScreen(Engine* engine, std::unique_ptr<Level> level)
     keepAlive(settings.graphics.backlight.observe([=](bool) {
         controller->getLevel()->chunks->saveAndClear();
     }));
+    keepAlive(settings.graphics.greedyMeshing.observe([=](bool) {
+        controller->getLevel()->chunks->saveAndClear();
+    }));
     keepAlive(settings.camera.fov.observe([=](double value) {
         controller->getPlayer()->camera->setFov(glm::radians(value));
     }));
@@ -4,7 +4,32 @@
 int Mesh::meshesCount = 0;
 int Mesh::drawCalls = 0;
 
-Mesh::Mesh(const float* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices, const vattr* attrs) : 
+static size_t attr_type_size(vattr_type type) {
+    switch (type) {
+        case vattr_type::int16:
+        case vattr_type::uint16:
+            return 2;
+        case vattr_type::uint8:
+            return 1;
+        default:
+            return sizeof(float);
+    }
+}
+
+static GLenum attr_gl_type(vattr_type type) {
+    switch (type) {
+        case vattr_type::int16:
+            return GL_SHORT;
+        case vattr_type::uint16:
+            return GL_UNSIGNED_SHORT;
+        case vattr_type::uint8:
+            return GL_UNSIGNED_BYTE;
+        default:
+            return GL_FLOAT;
+    }
+}
+
+Mesh::Mesh(const void* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices, const vattr* attrs) : 
     ibo(0),
     vertices(vertices),
     indices(indices)
@@ -12,7 +37,7 @@ Mesh::Mesh(const float* vertexBuffer, size_t vertices, const int* indexBuffer, s
     meshesCount++;
     vertexSize = 0;
     for (int i = 0; attrs[i].size; i++) {
-        vertexSize += attrs[i].size;
+        vertexSize += attrs[i].size * attr_type_size(attrs[i].type);
     }
 
     glGenVertexArrays(1, &vao);
@@ -21,12 +46,19 @@ Mesh::Mesh(const float* vertexBuffer, size_t vertices, const int* indexBuffer, s
     reload(vertexBuffer, vertices, indexBuffer, indices);
 
     // attributes
-    int offset = 0;
+    size_t offset = 0;
     for (int i = 0; attrs[i].size; i++) {
-        int size = attrs[i].size;
-        glVertexAttribPointer(i, size, GL_FLOAT, GL_FALSE, vertexSize * sizeof(float), (GLvoid*)(offset * sizeof(float)));
+        const auto& attr = attrs[i];
+        glVertexAttribPointer(
+            i,
+            attr.size,
+            attr_gl_type(attr.type),
+            attr.normalized ? GL_TRUE : GL_FALSE,
+            vertexSize,
+            (GLvoid*)offset
+        );
         glEnableVertexAttribArray(i);
-        offset += size;
+        offset += attr.size * attr_type_size(attr.type);
     }
 
     glBindVertexArray(0);
@@ -39,11 +71,11 @@ Mesh::~Mesh(){
     if (ibo != 0) glDeleteBuffers(1, &ibo);
 }
 
-void Mesh::reload(const float* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices){
+void Mesh::reload(const void* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices){
     glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     if (vertexBuffer != nullptr && vertices != 0) {
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertexSize * vertices, vertexBuffer, GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertexSize * vertices, vertexBuffer, GL_STATIC_DRAW);
     }
     else {
         glBufferData(GL_ARRAY_BUFFER, 0, {}, GL_STATIC_DRAW);
@@ -4,8 +4,18 @@
 #include <stdlib.h>
 #include <typedefs.hpp>
 
+enum class vattr_type : ubyte {
+    float32,
+    int16,
+    uint16,
+    uint8
+};
+
 struct vattr {
     ubyte size;
+    vattr_type type = vattr_type::float32;
+    /// @brief Integer values are mapped to [0, 1] or [-1, 1] if true
+    bool normalized = false;
 };
 
 class Mesh {
@@ -14,10 +24,11 @@ class Mesh {
     unsigned int ibo;
     size_t vertices;
     size_t indices;
+    /// @brief Vertex size in bytes
     size_t vertexSize;
 public:
-    Mesh(const float* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices, const vattr* attrs);
-    Mesh(const float* vertexBuffer, size_t vertices, const vattr* attrs) :
+    Mesh(const void* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices, const vattr* attrs);
+    Mesh(const void* vertexBuffer, size_t vertices, const vattr* attrs) :
         Mesh(vertexBuffer, vertices, nullptr, 0, attrs) {};
     ~Mesh();
 
@@ -26,7 +37,7 @@ public:
     /// @param vertices number of vertices in new buffer
     /// @param indexBuffer indices buffer
     /// @param indices number of values in indices buffer
-    void reload(const float* vertexBuffer, size_t vertices, const int* indexBuffer = nullptr, size_t indices = 0);
+    void reload(const void* vertexBuffer, size_t vertices, const int* indexBuffer = nullptr, size_t indices = 0);
     
     /// @brief Draw mesh with specified primitives type
     /// @param primitive primitives type
@@ -10,6 +10,7 @@
 #include <voxels/ChunksStorage.hpp>
 #include <lighting/Lightmap.hpp>
 #include <frontend/ContentGfxCache.hpp>
+#include <util/BufferPool.hpp>
 #include <settings.hpp>
 
 #include <glm/glm.hpp>
@@ -18,7 +19,92 @@ using glm::ivec3;
 using glm::vec3;
 using glm::vec4;
 
-const uint BlocksRenderer::VERTEX_SIZE = 6;
+/// @brief Visible full cube face in greedy meshing mask
+struct GreedyFace {
+    UVRegion region;
+    uint32_t lights[4];
+    bool visible;
+
+    /// @brief Check if all corners have the same light, so the face
+    /// shading does not depend on its size
+    inline bool isUniform() const {
+        return lights[0] == lights[1] && lights[0] == lights[2] &&
+               lights[0] == lights[3];
+    }
+
+    /// @brief Only faces with uniform lights are merged, otherwise the
+    /// corner lights gradient would be stretched over the merged quad
+    inline bool canMerge(const GreedyFace& other) const {
+        return visible && other.visible && isUniform() &&
+               region.u1 == other.region.u1 && region.v1 == other.region.v1 &&
+               region.u2 == other.region.u2 && region.v2 == other.region.v2 &&
+               lights[0] == other.lights[0] && other.isUniform();
+    }
+};
+
+/// @brief Full cube face axes as used in blockCube and texture index
+struct CubeFace {
+    ivec3 X, Y, Z;
+    int texture;
+};
+
+static const CubeFace CUBE_FACES[6] {
+    {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}, 5},    // north
+    {{-1, 0, 0}, {0, 1, 0}, {0, 0, -1}, 4},  // south
+    {{1, 0, 0}, {0, 0, -1}, {0, 1, 0}, 3},   // top
+    {{1, 0, 0}, {0, 0, 1}, {0, -1, 0}, 2},   // bottom
+    {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}, 1},   // west
+    {{0, 0, 1}, {0, 1, 0}, {-1, 0, 0}, 0},   // east
+};
+
+/// @brief Merged face size limit in blocks, tiles coordinates are 8 bit
+inline constexpr int MAX_GREEDY_TILES = 255;
+
+/// @brief Greedy mask size enough for any chunk slice
+inline constexpr int GREEDY_MASK_SIZE =
+    CHUNK_H * (CHUNK_W > CHUNK_D ? CHUNK_W : CHUNK_D);
+
+static uint32_t compress_light(const vec4& light) {
+    uint32_t compressed;
+    compressed = (static_cast<uint32_t>(light.r * 255) & 0xff) << 24;
+    compressed |= (static_cast<uint32_t>(light.g * 255) & 0xff) << 16;
+    compressed |= (static_cast<uint32_t>(light.b * 255) & 0xff) << 8;
+    compressed |= (static_cast<uint32_t>(light.a * 255) & 0xff);
+    return compressed;
+}
+
+static uint16_t compress_unorm16(float value) {
+    return static_cast<uint16_t>(glm::clamp(value, 0.0f, 1.0f) * 0xFFFF + 0.5f);
+}
+
+/// @brief Chunk-local position fixed point scale,
+/// must match CHUNK_POSITION_SCALE in shaders
+inline constexpr float VERTEX_POSITION_SCALE = 64.0f;
+
+/// @brief Packed chunk mesh vertex
+struct ChunkVertex {
+    /// @brief Chunk-local position in fixed point
+    int16_t position[3];
+    /// @brief Texture tiles coordinates of a merged face, zero otherwise
+    uint8_t tiles[2];
+    /// @brief Normalized texture coordinates
+    uint16_t uv[2];
+    /// @brief Normalized RGBS light
+    uint8_t light[4];
+};
+
+/// @brief Greedy meshing mode vertex suffix: normalized texture region
+/// (u1, v1, u2, v2) of a merged face, zero otherwise
+struct ChunkVertexRegion {
+    uint16_t region[4];
+};
+
+const uint BlocksRenderer::VERTEX_SIZE = sizeof(ChunkVertex);
+const uint BlocksRenderer::GREEDY_VERTEX_SIZE =
+    sizeof(ChunkVertex) + sizeof(ChunkVertexRegion);
+
+static_assert(sizeof(ChunkVertex) == 16);
+static_assert(sizeof(ChunkVertexRegion) == 8);
 const vec3 BlocksRenderer::SUN_VECTOR (0.411934f, 0.863868f, -0.279161f);
 
 BlocksRenderer::BlocksRenderer(
@@ -27,14 +113,16 @@ BlocksRenderer::BlocksRenderer(
     const ContentGfxCache* cache,
     const EngineSettings* settings
 ) : content(content),
-    vertexBuffer(std::make_unique<float[]>(capacity)),
-    indexBuffer(std::make_unique<int[]>(capacity)),
+    vertexBuffer(new ubyte[getVertexBufferSize(capacity)]),
+    indexBuffer(new int[getIndexBufferSize(capacity)]),
     vertexOffset(0),
     indexOffset(0),
     indexSize(0),
-    capacity(capacity),
+    capacity(getVertexBufferSize(capacity)),
+    vertexSize(VERTEX_SIZE),
+    greedyMask(std::make_unique<GreedyFace[]>(GREEDY_MASK_SIZE)),
     cache(cache),
-    settings(settings) 
+    settings(settings)
 {
     voxelsBuffer = std::make_unique<VoxelsVolume>(
         CHUNK_W + voxelBufferPadding*2, 
@@ -48,24 +136,34 @@ BlocksRenderer::~BlocksRenderer() {
 
 /* Basic vertex add method */
 void BlocksRenderer::vertex(const vec3& coord, float u, float v, const vec4& light) {
-    vertexBuffer[vertexOffset++] = coord.x;
-    vertexBuffer[vertexOffset++] = coord.y;
-    vertexBuffer[vertexOffset++] = coord.z;
-
-    vertexBuffer[vertexOffset++] = u;
-    vertexBuffer[vertexOffset++] = v;
-
-    union {
-        float floating;
-        uint32_t integer;
-    } compressed;
-
-    compressed.integer = (static_cast<uint32_t>(light.r * 255) & 0xff) << 24;
-    compressed.integer |= (static_cast<uint32_t>(light.g * 255) & 0xff) << 16;
-    compressed.integer |= (static_cast<uint32_t>(light.b * 255) & 0xff) << 8;
-    compressed.integer |= (static_cast<uint32_t>(light.a * 255) & 0xff);
+    vertex(coord, u, v, compress_light(light));
+}
 
-    vertexBuffer[vertexOffset++] = compressed.floating;
+void BlocksRenderer::vertex(const vec3& coord, float u, float v, uint32_t light) {
+    auto& dst =
+        *reinterpret_cast<ChunkVertex*>(vertexBuffer.get() + vertexOffset);
+    vec3 position = glm::round(coord * VERTEX_POSITION_SCALE);
+    dst.position[0] = static_cast<int16_t>(position.x);
+    dst.position[1] = static_cast<int16_t>(position.y);
+    dst.position[2] = static_cast<int16_t>(position.z);
+    dst.tiles[0] = 0;
+    dst.tiles[1] = 0;
+    dst.uv[0] = compress_unorm16(u);
+    dst.uv[1] = compress_unorm16(v);
+    dst.light[0] = (light >> 24) & 0xFF;
+    dst.light[1] = (light >> 16) & 0xFF;
+    dst.light[2] = (light >> 8) & 0xFF;
+    dst.light[3] = light & 0xFF;
+    vertexOffset += sizeof(ChunkVertex);
+
+    if (greedy) {
+        // zero texture region: texture coordinates are not tiled
+        auto& suffix = *reinterpret_cast<ChunkVertexRegion*>(
+            vertexBuffer.get() + vertexOffset
+        );
+        suffix = {};
+        vertexOffset += sizeof(ChunkVertexRegion);
+    }
 }
 
 void BlocksRenderer::index(int a, int b, int c, int d, int e, int f) {
@@ -89,7 +187,7 @@ void BlocksRenderer::face(
     const vec4(&lights)[4],
     const vec4& tint
 ) {
-    if (vertexOffset + BlocksRenderer::VERTEX_SIZE * 4 > capacity) {
+    if (vertexOffset + vertexSize * 4 > capacity) {
         overflow = true;
         return;
     }
@@ -125,7 +223,7 @@ void BlocksRenderer::faceAO(
     const UVRegion& region,
     bool lights
 ) {
-    if (vertexOffset + BlocksRenderer::VERTEX_SIZE * 4 > capacity) {
+    if (vertexOffset + vertexSize * 4 > capacity) {
         overflow = true;
         return;
     }
@@ -163,7 +261,7 @@ void BlocksRenderer::face(
     vec4 tint,
     bool lights
 ) {
-    if (vertexOffset + BlocksRenderer::VERTEX_SIZE * 4 > capacity) {
+    if (vertexOffset + vertexSize * 4 > capacity) {
         overflow = true;
         return;
     }
@@ -412,6 +510,184 @@ void BlocksRenderer::blockCube(
     }
 }
 
+bool BlocksRenderer::isGreedyCube(const Block& def, blockstate state) const {
+    return def.model == BlockModel::block && !def.rotatable && !state.segment;
+}
+
+void BlocksRenderer::cubeFaceLights(
+    const ivec3& coord,
+    const ivec3& X,
+    const ivec3& Y,
+    const ivec3& Z,
+    bool lights,
+    bool ao,
+    uint32_t (&dst)[4]
+) const {
+    float d = 1.0f;
+    if (lights) {
+        d = 0.8f + glm::dot(vec3(Z), SUN_VECTOR) * 0.2f;
+    }
+    if (ao) {
+        if (!lights) {
+            dst[0] = dst[1] = dst[2] = dst[3] = compress_light(vec4(1.0f));
+            return;
+        }
+        // same light sampling points as vertexAO uses
+        ivec3 base = coord + Z;
+        dst[0] = compress_light(pickSoftLight(base, X, Y) * d);
+        dst[1] = compress_light(pickSoftLight(base + X, X, Y) * d);
+        dst[2] = compress_light(pickSoftLight(base + X + Y, X, Y) * d);
+        dst[3] = compress_light(pickSoftLight(base + Y, X, Y) * d);
+    } else {
+        uint32_t light = compress_light(pickLight(coord + Z) * d);
+        dst[0] = dst[1] = dst[2] = dst[3] = light;
+    }
+}
+
+void BlocksRenderer::greedyQuad(
+    const vec3& coord,
+    const vec3& X,
+    const vec3& Y,
+    const vec3& Z,
+    int width,
+    int height,
+    const GreedyFace& face
+) {
+    if (vertexOffset + vertexSize * 4 > capacity) {
+        overflow = true;
+        return;
+    }
+    const auto& region = face.region;
+    const ChunkVertexRegion packedRegion {{
+        compress_unorm16(region.u1),
+        compress_unorm16(region.v1),
+        compress_unorm16(region.u2),
+        compress_unorm16(region.v2),
+    }};
+    const vec3 positions[4] {
+        coord + (-X - Y + Z) * 0.5f,
+        coord + (X - Y + Z) * 0.5f,
+        coord + (X + Y + Z) * 0.5f,
+        coord + (-X + Y + Z) * 0.5f,
+    };
+    // texture is tiled in shader using tiles coordinates and region
+    const int tiles[8] {0, 0, width, 0, width, height, 0, height};
+    for (int i = 0; i < 4; i++) {
+        size_t offset = vertexOffset;
+        vertex(positions[i], 0.0f, 0.0f, face.lights[i]);
+        auto& dst =
+            *reinterpret_cast<ChunkVertex*>(vertexBuffer.get() + offset);
+        dst.tiles[0] = tiles[i * 2];
+        dst.tiles[1] = tiles[i * 2 + 1];
+        *reinterpret_cast<ChunkVertexRegion*>(
+            vertexBuffer.get() + offset + sizeof(ChunkVertex)
+        ) = packedRegion;
+    }
+    index(0, 1, 2, 0, 2, 3);
+}
+
+void BlocksRenderer::greedyCubes(const voxel* voxels, ubyte drawGroup) {
+    const int mins[3] {0, chunk->bottom, 0};
+    const int maxs[3] {CHUNK_W, chunk->top, CHUNK_D};
+
+    for (const auto& face : CUBE_FACES) {
+        // axes indices: along face width, along face height and normal
+        int a = face.X.x ? 0 : (face.X.y ? 1 : 2);
+        int b = face.Y.x ? 0 : (face.Y.y ? 1 : 2);
+        int n = face.Z.x ? 0 : (face.Z.y ? 1 : 2);
+        int width = maxs[a] - mins[a];
+        int height = maxs[b] - mins[b];
+        if (width <= 0 || height <= 0) {
+            continue;
+        }
+        for (int layer = mins[n]; layer < maxs[n]; layer++) {
+            ivec3 pos;
+            pos[n] = layer;
+            for (int j = 0; j < height; j++) {
+                for (int i = 0; i < width; i++) {
+                    pos[a] = mins[a] + i;
+                    pos[b] = mins[b] + j;
+                    auto& cell = greedyMask[j * width + i];
+                    cell.visible = false;
+
+                    const voxel& vox = voxels[vox_index(pos.x, pos.y, pos.z)];
+                    const Block& def = *blockDefsCache[vox.id];
+                    if (vox.id == 0 || def.drawGroup != drawGroup ||
+                        !isGreedyCube(def, vox.state)) {
+                        continue;
+                    }
+                    ivec3 facing = pos + face.Z;
+                    if (!isOpen(facing.x, facing.y, facing.z, drawGroup)) {
+                        continue;
+                    }
+                    cell.visible = true;
+                    cell.region = cache->getRegion(vox.id, face.texture);
+                    cubeFaceLights(
+                        pos,
+                        face.X,
+                        face.Y,
+                        face.Z,
+                        !def.shadeless,
+                        def.ambientOcclusion,
+                        cell.lights
+                    );
+                }
+            }
+            for (int j = 0; j < height; j++) {
+                for (int i = 0; i < width;) {
+                    const auto& cell = greedyMask[j * width + i];
+                    if (!cell.visible) {
+                        i++;
+                        continue;
+                    }
+                    int w = 1;
+                    while (i + w < width && w < MAX_GREEDY_TILES &&
+                           cell.canMerge(greedyMask[j * width + i + w])) {
+                        w++;
+                    }
+                    int h = 1;
+                    for (; j + h < height && h < MAX_GREEDY_TILES; h++) {
+                        bool rowMatches = true;
+                        for (int k = 0; k < w; k++) {
+                            const auto& other =
+                                greedyMask[(j + h) * width + i + k];
+                            if (!cell.canMerge(other)) {
+                                rowMatches = false;
+                                break;
+                            }
+                        }
+                        if (!rowMatches) {
+                            break;
+                        }
+                    }
+                    vec3 coord;
+                    coord[n] = layer;
+                    coord[a] = mins[a] + i + (w - 1) * 0.5f;
+                    coord[b] = mins[b] + j + (h - 1) * 0.5f;
+                    greedyQuad(
+                        coord,
+                        vec3(face.X) * static_cast<float>(w),
+                        vec3(face.Y) * static_cast<float>(h),
+                        vec3(face.Z),
+                        w,
+                        h,
+                        cell
+                    );
+                    if (overflow) {
+                        return;
+                    }
+                    for (int y = 0; y < h; y++) {
+                        for (int x = 0; x < w; x++) {
+                            greedyMask[(j + y) * width + i + x].visible = false;
+                        }
+                    }
+                    i += w;
+                }
+            }
+        }
+    }
+}
+
 // Does block allow to see other blocks sides (is it transparent)
 bool BlocksRenderer::isOpen(int x, int y, int z, ubyte group) const {
     blockid_t id = voxelsBuffer->pickBlockId(chunk->x * CHUNK_W + x, 
@@ -481,6 +757,12 @@ void BlocksRenderer::render(const voxel* voxels) {
     int begin = chunk->bottom * (CHUNK_W * CHUNK_D);
     int end = chunk->top * (CHUNK_W * CHUNK_D);
     for (const auto drawGroup : *content->drawGroups) {
+        if (greedy) {
+            greedyCubes(voxels, drawGroup);
+            if (overflow) {
+                return;
+            }
+        }
         for (int i = begin; i < end; i++) {
             const voxel& vox = voxels[i];
             blockid_t id = vox.id;
@@ -502,6 +784,9 @@ void BlocksRenderer::render(const voxel* voxels) {
             int z = (i / CHUNK_D) % CHUNK_W;
             switch (def.model) {
                 case BlockModel::block:
+                    if (greedy && isGreedyCube(def, vox.state)) {
+                        break;
+                    }
                     blockCube(x, y, z, texfaces, &def, vox.state, !def.shadeless,
                               def.ambientOcclusion);
                     break;
@@ -537,20 +822,77 @@ void BlocksRenderer::build(const Chunk* chunk, const ChunksStorage* chunks) {
         chunk->z * CHUNK_D - voxelBufferPadding);
     chunks->getVoxels(voxelsBuffer.get(), settings->graphics.backlight.get());
     overflow = false;
+    greedy = settings->graphics.greedyMeshing.get();
+    vertexSize = greedy ? GREEDY_VERTEX_SIZE : VERTEX_SIZE;
     vertexOffset = 0;
     indexOffset = indexSize = 0;
     const voxel* voxels = chunk->voxels;
     render(voxels);
 }
 
-std::shared_ptr<Mesh> BlocksRenderer::createMesh() {
-    const vattr attrs[]{ {3}, {2}, {1}, {0} };
-    size_t vcount = vertexOffset / BlocksRenderer::VERTEX_SIZE;
+static std::shared_ptr<Mesh> create_mesh(
+    const ubyte* vertices,
+    size_t verticesSize,
+    const int* indices,
+    size_t indicesCount,
+    bool greedy
+) {
+    size_t vertexSize = greedy
+        ? sizeof(ChunkVertex) + sizeof(ChunkVertexRegion)
+        : sizeof(ChunkVertex);
+    // must match ChunkVertex and ChunkVertexRegion layout
+    const vattr attrs[] {
+        {3, vattr_type::int16},
+        {2, vattr_type::uint8},
+        {2, vattr_type::uint16, true},
+        {4, vattr_type::uint8, true},
+        {greedy ? ubyte(4) : ubyte(0), vattr_type::uint16, true},
+        {0}};
     return std::make_shared<Mesh>(
-        vertexBuffer.get(), vcount, indexBuffer.get(), indexSize, attrs
+        vertices, verticesSize / vertexSize, indices, indicesCount, attrs
     );
 }
 
+std::shared_ptr<Mesh> BlocksRenderer::createMesh() {
+    return create_mesh(
+        vertexBuffer.get(), vertexOffset, indexBuffer.get(), indexSize, greedy
+    );
+}
+
+std::shared_ptr<Mesh> BlocksRenderer::createMesh(const ChunkMeshData& data) {
+    return create_mesh(
+        data.vertices.get(),
+        data.verticesSize,
+        data.indices.get(),
+        data.indicesCount,
+        data.greedy
+    );
+}
+
+ChunkMeshData BlocksRenderer::takeMesh(
+    util::BufferPool<ubyte>& vertexPool, util::BufferPool<int>& indexPool
+) {
+    ChunkMeshData data {
+        std::move(vertexBuffer),
+        vertexOffset,
+        std::move(indexBuffer),
+        indexSize,
+        greedy};
+    vertexBuffer = vertexPool.get();
+    indexBuffer = indexPool.get();
+    vertexOffset = 0;
+    indexOffset = indexSize = 0;
+    return data;
+}
+
+size_t BlocksRenderer::getVertexBufferSize(size_t capacity) {
+    return capacity * VERTEX_SIZE;
+}
+
+size_t BlocksRenderer::getIndexBufferSize(size_t capacity) {
+    return capacity * 3 / 2;
+}
+
 std::shared_ptr<Mesh> BlocksRenderer::render(const Chunk* chunk, const ChunksStorage* chunks) {
     build(chunk, chunks);
     return createMesh();
@@ -18,18 +18,45 @@ class ChunksStorage;
 class ContentGfxCache;
 struct EngineSettings;
 struct UVRegion;
+struct GreedyFace;
+
+namespace util {
+    template <class T>
+    class BufferPool;
+}
+
+/// @brief Chunk mesh built on CPU and not uploaded to GPU yet
+struct ChunkMeshData {
+    std::shared_ptr<ubyte[]> vertices;
+    /// @brief Vertices data size in bytes
+    size_t verticesSize;
+    std::shared_ptr<int[]> indices;
+    size_t indicesCount;
+    /// @brief Mesh is built in greedy meshing mode
+    bool greedy;
+};
 
 class BlocksRenderer {
     static const glm::vec3 SUN_VECTOR;
+    /// @brief Packed vertex size in bytes
     static const uint VERTEX_SIZE;
+    /// @brief Vertex size in greedy meshing mode: packed texture region
+    /// used to tile texture over merged faces is added
+    static const uint GREEDY_VERTEX_SIZE;
     const Content* const content;
-    std::unique_ptr<float[]> vertexBuffer;
-    std::unique_ptr<int[]> indexBuffer;
+    std::shared_ptr<ubyte[]> vertexBuffer;
+    std::shared_ptr<int[]> indexBuffer;
+    /// @brief Vertex buffer offset in bytes
     size_t vertexOffset;
     size_t indexOffset, indexSize;
+    /// @brief Vertex buffer size in bytes
     size_t capacity;
     int voxelBufferPadding = 2;
     bool overflow = false;
+    /// @brief Greedy meshing mode is used for the current mesh
+    bool greedy = false;
+    uint vertexSize;
+    std::unique_ptr<GreedyFace[]> greedyMask;
     const Chunk* chunk = nullptr;
     std::unique_ptr<VoxelsVolume> voxelsBuffer;
 
@@ -38,6 +65,7 @@ class BlocksRenderer {
     const EngineSettings* settings;
 
     void vertex(const glm::vec3& coord, float u, float v, const glm::vec4& light);
+    void vertex(const glm::vec3& coord, float u, float v, uint32_t light);
     void index(int a, int b, int c, int d, int e, int f);
 
     void vertexAO(
@@ -115,6 +143,31 @@ class BlocksRenderer {
         bool ao
     );
 
+    /// @brief Merge coplanar full cube faces having the same texture
+    /// and lights into larger quads
+    void greedyCubes(const voxel* voxels, ubyte drawGroup);
+    void greedyQuad(
+        const glm::vec3& coord,
+        const glm::vec3& X,
+        const glm::vec3& Y,
+        const glm::vec3& Z,
+        int width,
+        int height,
+        const GreedyFace& face
+    );
+    /// @brief Calculate vertex lights of a full cube face the same way as
+    /// blockCube does
+    void cubeFaceLights(
+        const glm::ivec3& coord,
+        const glm::ivec3& X,
+        const glm::ivec3& Y,
+        const glm::ivec3& Z,
+        bool lights,
+        bool ao,
+        uint32_t (&dst)[4]
+    ) const;
+    bool isGreedyCube(const Block& def, blockstate state) const;
+
     bool isOpenForLight(int x, int y, int z) const;
     bool isOpen(int x, int y, int z, ubyte group) const;
 
@@ -124,12 +177,30 @@ class BlocksRenderer {
     glm::vec4 pickSoftLight(float x, float y, float z, const glm::ivec3& right, const glm::ivec3& up) const;
     void render(const voxel* voxels);
 public:
+    /// @param capacity max number of vertices in mesh
     BlocksRenderer(size_t capacity, const Content* content, const ContentGfxCache* cache, const EngineSettings* settings);
     virtual ~BlocksRenderer();
 
     void build(const Chunk* chunk, const ChunksStorage* chunks);
     std::shared_ptr<Mesh> render(const Chunk* chunk, const ChunksStorage* chunks);
     std::shared_ptr<Mesh> createMesh();
+
+    /// @brief Take ownership of the built mesh buffers. Renderer continues
+    /// with buffers from the pools, so the mesh data may be uploaded
+    /// later while the next chunk is being built
+    ChunkMeshData takeMesh(
+        util::BufferPool<ubyte>& vertexPool, util::BufferPool<int>& indexPool
+    );
+
+    /// @brief Upload mesh data taken from renderer
+    static std::shared_ptr<Mesh> createMesh(const ChunkMeshData& data);
+
+    /// @param capacity max number of vertices in mesh
+    /// @return vertex buffer size in bytes
+    static size_t getVertexBufferSize(size_t capacity);
+    /// @param capacity max number of vertices in mesh
+    /// @return index buffer length
+    static size_t getIndexBufferSize(size_t capacity);
     VoxelsVolume* getVoxelsBuffer() const;
 };
 
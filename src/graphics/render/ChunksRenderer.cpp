@@ -6,29 +6,48 @@
 #include <world/Level.hpp>
 #include <settings.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
 static debug::Logger logger("chunks-render");
 
-const uint RENDERER_CAPACITY = 9 * 6 * 6 * 3000;
+/// @brief Max number of vertices in chunk mesh
+const uint RENDERER_CAPACITY = 9 * 6 * 3000;
+/// @brief Max number of remesh jobs enqueued per worker, the rest of
+/// requests wait to be reprioritized next frame
+const uint MAX_JOBS_PER_WORKER = 2;
+/// @brief Priority penalty of chunks out of the view frustum
+const float INVISIBLE_PRIORITY_PENALTY = 1e6f;
 
-class RendererWorker : public util::Worker<Chunk, RendererResult> {
+class RendererWorker : public util::Worker<RendererJob, RendererResult> {
     Level* level;
     BlocksRenderer renderer;
+    util::BufferPool<ubyte>& vertexPool;
+    util::BufferPool<int>& indexPool;
 public:
     RendererWorker(
         Level* level, 
         const ContentGfxCache* cache, 
-        const EngineSettings* settings
+        const EngineSettings* settings,
+        util::BufferPool<ubyte>& vertexPool,
+        util::BufferPool<int>& indexPool
     ) : level(level), 
-        renderer(RENDERER_CAPACITY, level->content, cache, settings)
+        renderer(RENDERER_CAPACITY, level->content, cache, settings),
+        vertexPool(vertexPool),
+        indexPool(indexPool)
     {}
 
-    RendererResult operator()(const std::shared_ptr<Chunk>& chunk) override {
+    RendererResult operator()(const std::shared_ptr<RendererJob>& job) override {
+        const auto& chunk = job->chunk;
+        glm::ivec2 key(chunk->x, chunk->z);
+        if (job->cancelled) {
+            return RendererResult {key, job.get(), {}};
+        }
         renderer.build(chunk.get(), level->chunksStorage.get());
-        return RendererResult {glm::ivec2(chunk->x, chunk->z), &renderer};
+        return RendererResult {
+            key, job.get(), renderer.takeMesh(vertexPool, indexPool)};
     }
 };
 
@@ -37,15 +56,26 @@ ChunksRenderer::ChunksRenderer(
     const ContentGfxCache* cache, 
     const EngineSettings* settings
 ) : level(level),
+    vertexPool(BlocksRenderer::getVertexBufferSize(RENDERER_CAPACITY)),
+    indexPool(BlocksRenderer::getIndexBufferSize(RENDERER_CAPACITY)),
     threadPool(
         "chunks-render-pool",
-        [=](){return std::make_shared<RendererWorker>(level, cache, settings);}, 
-        [=](RendererResult& mesh){
-            meshes[mesh.key] = mesh.renderer->createMesh();
-            inwork.erase(mesh.key);
+        [=](){
+            return std::make_shared<RendererWorker>(
+                level, cache, settings, vertexPool, indexPool
+            );
+        }, 
+        [=](RendererResult& result){
+            auto found = inwork.find(result.key);
+            if (found == inwork.end() || found->second.get() != result.job) {
+                // stale or cancelled job
+                return;
+            }
+            inwork.erase(found);
+            // buffers are returned to the pool when result is released
+            meshes[result.key] = BlocksRenderer::createMesh(result.mesh);
         })
 {
-    threadPool.setStandaloneResults(false);
     threadPool.setStopOnFail(false);
     renderer = std::make_unique<BlocksRenderer>(
         RENDERER_CAPACITY, level->content, cache, settings
@@ -56,40 +86,64 @@ ChunksRenderer::ChunksRenderer(
 ChunksRenderer::~ChunksRenderer() {
 }
 
-std::shared_ptr<Mesh> ChunksRenderer::render(const std::shared_ptr<Chunk>& chunk, bool important) {
-    chunk->flags.modified = false;
-    if (important) {
-        auto mesh = renderer->render(chunk.get(), level->chunksStorage.get());
-        meshes[glm::ivec2(chunk->x, chunk->z)] = mesh;
-        return mesh;
-    }
-    glm::ivec2 key(chunk->x, chunk->z);
-    if (inwork.find(key) != inwork.end()) {
-        return nullptr;
-    }
-    inwork[key] = true;
-    threadPool.enqueueJob(chunk);
-    return nullptr;
-}
-
-void ChunksRenderer::unload(const Chunk* chunk) {
-    auto found = meshes.find(glm::ivec2(chunk->x, chunk->z));
-    if (found != meshes.end()) {
-        meshes.erase(found);
-    }
-}
-
-std::shared_ptr<Mesh> ChunksRenderer::getOrRender(const std::shared_ptr<Chunk>& chunk, bool important) {
-    auto found = meshes.find(glm::ivec2(chunk->x, chunk->z));
-    if (found == meshes.end()) {
-        return render(chunk, important);
-    }
-    if (chunk->flags.modified) {
-        render(chunk, important);
-    }
-    return found->second;
-}
-
+void ChunksRenderer::cancel(const glm::ivec2& key) {
+    auto found = inwork.find(key);
+    if (found != inwork.end()) {
+        found->second->cancelled = true;
+        inwork.erase(found);
+    }
+}
+
+std::shared_ptr<Mesh> ChunksRenderer::render(
+    const std::shared_ptr<Chunk>& chunk,
+    bool important,
+    float distance,
+    bool visible
+) {
+    glm::ivec2 key(chunk->x, chunk->z);
+    if (important) {
+        chunk->flags.modified = false;
+        // the mesh is up to date, jobs in work are stale
+        cancel(key);
+        requests.erase(key);
+        auto mesh = renderer->render(chunk.get(), level->chunksStorage.get());
+        meshes[key] = mesh;
+        return mesh;
+    }
+    float priority = distance;
+    if (!visible) {
+        priority += INVISIBLE_PRIORITY_PENALTY;
+    }
+    requests[key] = RemeshRequest {chunk, priority};
+    return nullptr;
+}
+
+void ChunksRenderer::unload(const Chunk* chunk) {
+    glm::ivec2 key(chunk->x, chunk->z);
+    cancel(key);
+    requests.erase(key);
+    auto found = meshes.find(key);
+    if (found != meshes.end()) {
+        meshes.erase(found);
+    }
+}
+
+std::shared_ptr<Mesh> ChunksRenderer::getOrRender(
+    const std::shared_ptr<Chunk>& chunk,
+    bool important,
+    float distance,
+    bool visible
+) {
+    auto found = meshes.find(glm::ivec2(chunk->x, chunk->z));
+    if (found == meshes.end()) {
+        return render(chunk, important, distance, visible);
+    }
+    if (chunk->flags.modified) {
+        render(chunk, important, distance, visible);
+    }
+    return found->second;
+}
+
 std::shared_ptr<Mesh> ChunksRenderer::get(Chunk* chunk) {
     auto found = meshes.find(glm::ivec2(chunk->x, chunk->z));
     if (found != meshes.end()) {
@@ -101,3 +155,28 @@ std::shared_ptr<Mesh> ChunksRenderer::get(Chunk* chunk) {
 void ChunksRenderer::update() {
     threadPool.update();
 }
+
+void ChunksRenderer::scheduleRequests() {
+    std::vector<RemeshRequest*> sorted;
+    for (auto& [key, request] : requests) {
+        // modified chunk is requested again when current job is done
+        if (inwork.find(key) == inwork.end()) {
+            sorted.push_back(&request);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](auto a, auto b) {
+        return a->priority < b->priority;
+    });
+    size_t maxJobs = threadPool.getWorkersCount() * MAX_JOBS_PER_WORKER;
+    for (auto request : sorted) {
+        if (inwork.size() >= maxJobs) {
+            break;
+        }
+        const auto& chunk = request->chunk;
+        chunk->flags.modified = false;
+        auto job = std::make_shared<RendererJob>(chunk);
+        inwork[glm::ivec2(chunk->x, chunk->z)] = job;
+        threadPool.enqueueJob(job);
+    }
+    requests.clear();
+}
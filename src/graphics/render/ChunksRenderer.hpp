@@ -1,6 +1,7 @@
 #ifndef GRAPHICS_RENDER_CHUNKSRENDERER_HPP_
 #define GRAPHICS_RENDER_CHUNKSRENDERER_HPP_
 
+#include <atomic>
 #include <queue>
 #include <memory>
 #include <vector>
@@ -9,27 +10,54 @@
 
 #include <voxels/Block.hpp>
 #include <voxels/ChunksStorage.hpp>
+#include <util/BufferPool.hpp>
 #include <util/ThreadPool.hpp>
+#include "BlocksRenderer.hpp"
 
 class Mesh;
 class Chunk;
 class Level;
-class BlocksRenderer;
 class ContentGfxCache;
 struct EngineSettings;
 
+struct RendererJob {
+    std::shared_ptr<Chunk> chunk;
+    /// @brief Set if the job result is not needed anymore
+    std::atomic<bool> cancelled = false;
+
+    RendererJob(std::shared_ptr<Chunk> chunk) : chunk(std::move(chunk)) {
+    }
+};
+
 struct RendererResult {
     glm::ivec2 key;
-    BlocksRenderer* renderer;
+    /// @brief Job is used as identity to drop stale results
+    const RendererJob* job;
+    ChunkMeshData mesh;
+};
+
+/// @brief Chunk waiting for remesh job
+struct RemeshRequest {
+    std::shared_ptr<Chunk> chunk;
+    /// @brief Lower value is scheduled first
+    float priority;
 };
 
 class ChunksRenderer {
     Level* level;
     std::unique_ptr<BlocksRenderer> renderer;
+    /// @brief Buffers of meshes built by workers and waiting for upload
+    util::BufferPool<ubyte> vertexPool;
+    util::BufferPool<int> indexPool;
     std::unordered_map<glm::ivec2, std::shared_ptr<Mesh>> meshes;
-    std::unordered_map<glm::ivec2, bool> inwork;
+    std::unordered_map<glm::ivec2, std::shared_ptr<RendererJob>> inwork;
+    /// @brief Remesh requests of the current frame
+    std::unordered_map<glm::ivec2, RemeshRequest> requests;
 
-    util::ThreadPool<Chunk, RendererResult> threadPool;
+    util::ThreadPool<RendererJob, RendererResult> threadPool;
+
+    /// @brief Cancel chunk job if it's in work
+    void cancel(const glm::ivec2& key);
 public:
     ChunksRenderer(
         Level* level, 
@@ -38,13 +66,32 @@ public:
     );
     virtual ~ChunksRenderer();
 
-    std::shared_ptr<Mesh> render(const std::shared_ptr<Chunk>& chunk, bool important);
+    /// @brief Build chunk mesh now if important, otherwise request remesh
+    /// @param distance distance from camera to the chunk
+    /// @param visible chunk is inside of the view frustum
+    std::shared_ptr<Mesh> render(
+        const std::shared_ptr<Chunk>& chunk,
+        bool important,
+        float distance,
+        bool visible
+    );
     void unload(const Chunk* chunk);
 
-    std::shared_ptr<Mesh> getOrRender(const std::shared_ptr<Chunk>& chunk, bool important);
+    std::shared_ptr<Mesh> getOrRender(
+        const std::shared_ptr<Chunk>& chunk,
+        bool important,
+        float distance,
+        bool visible
+    );
     std::shared_ptr<Mesh> get(Chunk* chunk);
 
+    /// @brief Upload finished meshes
     void update();
+
+    /// @brief Enqueue the most urgent remesh requests of the frame:
+    /// visible chunks first, nearest first. Requests not enqueued are
+    /// dropped and expected to be repeated next frame
+    void scheduleRequests();
 };
 
 #endif // GRAPHICS_RENDER_CHUNKSRENDERER_HPP_
@@ -91,10 +91,7 @@ bool WorldRenderer::drawChunk(
             (chunk->z + 0.5f) * CHUNK_D
         )
     );
-    auto mesh = renderer->getOrRender(chunk, distance < CHUNK_W * 1.5f);
-    if (mesh == nullptr) {
-        return false;
-    }
+    bool visible = true;
     if (culling) {
         glm::vec3 min(chunk->x * CHUNK_W, chunk->bottom, chunk->z * CHUNK_D);
         glm::vec3 max(
@@ -102,8 +99,13 @@ bool WorldRenderer::drawChunk(
             chunk->top,
             chunk->z * CHUNK_D + CHUNK_D
         );
-
-        if (!frustumCulling->isBoxVisible(min, max)) return false;
+        visible = frustumCulling->isBoxVisible(min, max);
+    }
+    auto mesh = renderer->getOrRender(
+        chunk, distance < CHUNK_W * 1.5f, distance, visible
+    );
+    if (mesh == nullptr || !visible) {
+        return false;
     }
     glm::vec3 coord(chunk->x * CHUNK_W + 0.5f, 0.5f, chunk->z * CHUNK_D + 0.5f);
     glm::mat4 model = glm::translate(glm::mat4(1.0f), coord);
@@ -145,6 +147,7 @@ void WorldRenderer::drawChunks(Chunks* chunks, Camera* camera, Shader* shader) {
     for (size_t i = 0; i < indices.size(); i++) {
         chunks->visible += drawChunk(indices[i], camera, shader, culling);
     }
+    renderer->scheduleRequests();
 }
 
 void WorldRenderer::setupWorldShader(
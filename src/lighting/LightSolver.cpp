@@ -1,114 +1,211 @@
-#include <iostream>
-#include <assert.h>
 #include "LightSolver.hpp"
-#include "Lightmap.hpp"
+
+#include <assert.h>
+
 #include <content/Content.hpp>
-#include <voxels/Chunks.hpp>
+#include <maths/voxmaths.hpp>
+#include <voxels/Block.hpp>
 #include <voxels/Chunk.hpp>
+#include <voxels/Chunks.hpp>
 #include <voxels/voxel.hpp>
-#include <voxels/Block.hpp>
+#include "Lightmap.hpp"
 
-LightSolver::LightSolver(const ContentIndices* contentIds, Chunks* chunks, int channel) 
-	: contentIds(contentIds), 
-	  chunks(chunks), 
-	  channel(channel) {
+inline constexpr uint32_t NO_CHUNK = 0xFFFFFFFF;
+inline constexpr size_t LIGHT_QUEUE_INITIAL_CAPACITY = 4096;
+
+LightQueue::LightQueue() : buffer(LIGHT_QUEUE_INITIAL_CAPACITY) {
 }
 
-void LightSolver::add(int x, int y, int z, int emission) {
-	if (emission <= 1)
-		return;
+void LightQueue::grow() {
+    std::vector<lightentry> extended(buffer.size() * 2);
+    for (size_t i = 0; i < count; i++) {
+        extended[i] = buffer[(head + i) & (buffer.size() - 1)];
+    }
+    buffer = std::move(extended);
+    head = 0;
+}
 
-	addqueue.push(lightentry {x, y, z, ubyte(emission)});
+LightSolver::LightSolver(
+    const ContentIndices* contentIds, Chunks* chunks, int channel
+)
+    : contentIds(contentIds),
+      chunks(chunks),
+      channel(channel),
+      cachedIndex(NO_CHUNK) {
+}
+
+void LightSolver::updateCache(uint32_t chunkIndex) {
+    const uint w = chunks->w;
+    const uint d = chunks->d;
+    const uint cx = chunkIndex % w;
+    const uint cz = chunkIndex / w;
+    const auto& matrix = chunks->chunks;
+    cached[0] = matrix[chunkIndex].get();
+    cached[1] = cx + 1 < w ? matrix[chunkIndex + 1].get() : nullptr;
+    cached[2] = cx > 0 ? matrix[chunkIndex - 1].get() : nullptr;
+    cached[3] = cz + 1 < d ? matrix[chunkIndex + w].get() : nullptr;
+    cached[4] = cz > 0 ? matrix[chunkIndex - w].get() : nullptr;
+    cachedIndex = chunkIndex;
+}
+
+Chunk* LightSolver::resolve(
+    int x, int y, int z, uint32_t& chunkIndex, uint& index
+) {
+    if (y < 0 || y >= CHUNK_H) {
+        return nullptr;
+    }
+    x -= chunks->ox * CHUNK_W;
+    z -= chunks->oz * CHUNK_D;
+    int cx = floordiv(x, CHUNK_W);
+    int cz = floordiv(z, CHUNK_D);
+    if (cx < 0 || cz < 0 || cx >= int(chunks->w) || cz >= int(chunks->d)) {
+        return nullptr;
+    }
+    chunkIndex = cz * chunks->w + cx;
+    index = vox_index(x - cx * CHUNK_W, y, z - cz * CHUNK_D);
+    return chunks->chunks[chunkIndex].get();
+}
+
+inline Chunk* LightSolver::getNeighbour(
+    int side, uint32_t& chunkIndex, uint& index
+) {
+    const int lx = index % CHUNK_W;
+    const int lz = (index / CHUNK_W) % CHUNK_D;
+    const int y = index / (CHUNK_W * CHUNK_D);
+    switch (side) {
+        case 0:
+            if (lx + 1 < CHUNK_W) {
+                index++;
+                return cached[0];
+            }
+            index -= CHUNK_W - 1;
+            chunkIndex++;
+            return cached[1];
+        case 1:
+            if (lx > 0) {
+                index--;
+                return cached[0];
+            }
+            index += CHUNK_W - 1;
+            chunkIndex--;
+            return cached[2];
+        case 2:
+            if (lz + 1 < CHUNK_D) {
+                index += CHUNK_W;
+                return cached[0];
+            }
+            index -= (CHUNK_D - 1) * CHUNK_W;
+            chunkIndex += chunks->w;
+            return cached[3];
+        case 3:
+            if (lz > 0) {
+                index -= CHUNK_W;
+                return cached[0];
+            }
+            index += (CHUNK_D - 1) * CHUNK_W;
+            chunkIndex -= chunks->w;
+            return cached[4];
+        case 4:
+            if (y + 1 < CHUNK_H) {
+                index += CHUNK_W * CHUNK_D;
+                return cached[0];
+            }
+            return nullptr;
+        default:
+            if (y > 0) {
+                index -= CHUNK_W * CHUNK_D;
+                return cached[0];
+            }
+            return nullptr;
+    }
+}
+
+void LightSolver::add(int x, int y, int z, int emission) {
+    if (emission <= 1) {
+        return;
+    }
+    uint32_t chunkIndex;
+    uint index;
+    Chunk* chunk = resolve(x, y, z, chunkIndex, index);
+    if (chunk == nullptr) {
+        return;
+    }
+    addqueue.push(lightentry {chunkIndex, uint16_t(index), ubyte(emission)});
 
-	Chunk* chunk = chunks->getChunkByVoxel(x, y, z);
     chunk->flags.modified = true;
-	chunk->lightmap.set(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel, emission);
+    chunk->lightmap.set(index, channel, emission);
 }
 
 void LightSolver::add(int x, int y, int z) {
-	assert (chunks != nullptr);
-	add(x,y,z, chunks->getLight(x,y,z, channel));
+    assert(chunks != nullptr);
+    add(x, y, z, chunks->getLight(x, y, z, channel));
 }
 
 void LightSolver::remove(int x, int y, int z) {
-	Chunk* chunk = chunks->getChunkByVoxel(x, y, z);
-	if (chunk == nullptr)
-		return;
-
-	ubyte light = chunk->lightmap.get(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel);
-	if (light == 0){
-		return;
-	}
-	remqueue.push(lightentry {x, y, z, light});
-	chunk->lightmap.set(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel, 0);
+    uint32_t chunkIndex;
+    uint index;
+    Chunk* chunk = resolve(x, y, z, chunkIndex, index);
+    if (chunk == nullptr) {
+        return;
+    }
+    ubyte light = chunk->lightmap.get(index, channel);
+    if (light == 0) {
+        return;
+    }
+    remqueue.push(lightentry {chunkIndex, uint16_t(index), light});
+    chunk->lightmap.set(index, channel, 0);
 }
 
-void LightSolver::solve(){
-	const int coords[] = {
-			0, 0, 1,
-			0, 0,-1,
-			0, 1, 0,
-			0,-1, 0,
-			1, 0, 0,
-		   -1, 0, 0
-	};
-
-	while (!remqueue.empty()){
-		const lightentry entry = remqueue.front();
-		remqueue.pop();
-
-		for (int i = 0; i < 6; i++) {
-			int imul3 = i*3;
-			int x = entry.x+coords[imul3];
-			int y = entry.y+coords[imul3+1];
-			int z = entry.z+coords[imul3+2];
-			
-			Chunk* chunk = chunks->getChunkByVoxel(x,y,z);
-			if (chunk) {
-				int lx = x - chunk->x * CHUNK_W;
-				int lz = z - chunk->z * CHUNK_D;
-                chunk->flags.modified = true;
-
-				ubyte light = chunk->lightmap.get(lx,y,lz, channel);
-				if (light != 0 && light == entry.light-1){
-					remqueue.push(lightentry {x, y, z, light});
-					chunk->lightmap.set(lx, y, lz, channel, 0);
-				}
-				else if (light >= entry.light){
-					addqueue.push(lightentry {x, y, z, light});
-				}
-			}
-		}
-	}
-
-	const Block* const* blockDefs = contentIds->blocks.getDefs();
-	while (!addqueue.empty()){
-		const lightentry entry = addqueue.front();
-		addqueue.pop();
-
-		for (int i = 0; i < 6; i++) {
-			int imul3 = i*3;
-			int x = entry.x+coords[imul3];
-			int y = entry.y+coords[imul3+1];
-			int z = entry.z+coords[imul3+2];
-
-			Chunk* chunk = chunks->getChunkByVoxel(x,y,z);
-			if (chunk) {
-				int lx = x - chunk->x * CHUNK_W;
-				int lz = z - chunk->z * CHUNK_D;
-                chunk->flags.modified = true;
-
-				ubyte light = chunk->lightmap.get(lx, y, lz, channel);
-				voxel& v = chunk->voxels[vox_index(lx, y, lz)];
-				const Block* block = blockDefs[v.id];
-				if (block->lightPassing && light+2 <= entry.light){
-					chunk->lightmap.set(
-						x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, 
-						channel, 
-						entry.light-1);
-					addqueue.push(lightentry {x, y, z, ubyte(entry.light-1)});
-				}
-			}
-		}
-	}
+void LightSolver::solve() {
+    // chunks matrix may be changed since the last solve
+    cachedIndex = NO_CHUNK;
+
+    while (!remqueue.empty()) {
+        const lightentry entry = remqueue.pop();
+        if (entry.chunk != cachedIndex) {
+            updateCache(entry.chunk);
+        }
+        for (int side = 0; side < 6; side++) {
+            uint32_t chunkIndex = entry.chunk;
+            uint index = entry.index;
+            Chunk* chunk = getNeighbour(side, chunkIndex, index);
+            if (chunk == nullptr) {
+                continue;
+            }
+            chunk->flags.modified = true;
+
+            ubyte light = chunk->lightmap.get(index, channel);
+            if (light != 0 && light == entry.light - 1) {
+                remqueue.push(lightentry {chunkIndex, uint16_t(index), light});
+                chunk->lightmap.set(index, channel, 0);
+            } else if (light >= entry.light) {
+                addqueue.push(lightentry {chunkIndex, uint16_t(index), light});
+            }
+        }
+    }
+
+    const Block* const* blockDefs = contentIds->blocks.getDefs();
+    while (!addqueue.empty()) {
+        const lightentry entry = addqueue.pop();
+        if (entry.chunk != cachedIndex) {
+            updateCache(entry.chunk);
+        }
+        for (int side = 0; side < 6; side++) {
+            uint32_t chunkIndex = entry.chunk;
+            uint index = entry.index;
+            Chunk* chunk = getNeighbour(side, chunkIndex, index);
+            if (chunk == nullptr) {
+                continue;
+            }
+            chunk->flags.modified = true;
+
+            ubyte light = chunk->lightmap.get(index, channel);
+            const Block* block = blockDefs[chunk->voxels[index].id];
+            if (block->lightPassing && light + 2 <= entry.light) {
+                chunk->lightmap.set(index, channel, entry.light - 1);
+                addqueue.push(lightentry {
+                    chunkIndex, uint16_t(index), ubyte(entry.light - 1)});
+            }
+        }
+    }
 }
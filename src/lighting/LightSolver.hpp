@@ -1,24 +1,79 @@
 #ifndef LIGHTING_LIGHTSOLVER_HPP_
 #define LIGHTING_LIGHTSOLVER_HPP_
 
-#include <queue>
+#include <vector>
 
+#include <constants.hpp>
+#include <typedefs.hpp>
+
+class Chunk;
 class Chunks;
 class ContentIndices;
 
+static_assert(CHUNK_VOL <= 0x10000, "voxel index must fit 16 bits");
+
 struct lightentry {
-    int x;
-    int y;
-    int z;
-    unsigned char light;
+    /// @brief index of chunk in Chunks matrix
+    uint32_t chunk;
+    /// @brief voxel index inside of the chunk
+    uint16_t index;
+    ubyte light;
+};
+
+/// @brief Reusable FIFO ring buffer of light entries.
+/// Capacity is a power of two, grows when full and never shrinks
+class LightQueue {
+    std::vector<lightentry> buffer;
+    size_t head = 0;
+    size_t count = 0;
+
+    void grow();
+public:
+    LightQueue();
+
+    inline bool empty() const {
+        return count == 0;
+    }
+
+    inline void push(const lightentry& entry) {
+        if (count == buffer.size()) {
+            grow();
+        }
+        buffer[(head + count) & (buffer.size() - 1)] = entry;
+        count++;
+    }
+
+    inline lightentry pop() {
+        lightentry entry = buffer[head];
+        head = (head + 1) & (buffer.size() - 1);
+        count--;
+        return entry;
+    }
 };
 
 class LightSolver {
-    std::queue<lightentry> addqueue;
-    std::queue<lightentry> remqueue;
+    LightQueue addqueue;
+    LightQueue remqueue;
     const ContentIndices* const contentIds;
     Chunks* chunks;
     int channel;
+
+    /// @brief Chunks matrix index of the cached chunk
+    uint32_t cachedIndex;
+    /// @brief Cached chunk and its neighbours: center, +x, -x, +z, -z
+    Chunk* cached[5] {};
+
+    void updateCache(uint32_t chunkIndex);
+    /// @brief Find chunk containing the given global voxel position
+    /// @return chunk or nullptr if not loaded
+    Chunk* resolve(int x, int y, int z, uint32_t& chunkIndex, uint& index);
+    /// @brief Get neighbour of the cached chunk voxel
+    /// @param side neighbour side index [0..5]
+    /// @param chunkIndex chunk index, updated if neighbour is in
+    /// another chunk
+    /// @param index voxel index, updated to neighbour voxel index
+    /// @return chunk containing neighbour voxel or nullptr if not loaded
+    Chunk* getNeighbour(int side, uint32_t& chunkIndex, uint& index);
 public:
     LightSolver(const ContentIndices* contentIds, Chunks* chunks, int channel);
 
@@ -201,3 +201,66 @@ void Lighting::onBlockSet(int x, int y, int z, blockid_t id){
         }
     }
 }
+
+void Lighting::onBlocksSet(const std::vector<glm::ivec3>& positions) {
+    auto indices = content->getIndices();
+    for (const auto& pos : positions) {
+        voxel* vox = chunks->get(pos.x, pos.y, pos.z);
+        if (vox == nullptr) {
+            continue;
+        }
+        solverR->remove(pos.x, pos.y, pos.z);
+        solverG->remove(pos.x, pos.y, pos.z);
+        solverB->remove(pos.x, pos.y, pos.z);
+        if (vox->id != 0 && !indices->blocks.require(vox->id).skyLightPassing) {
+            solverS->remove(pos.x, pos.y, pos.z);
+            for (int y = pos.y - 1; y >= 0; y--) {
+                solverS->remove(pos.x, y, pos.z);
+                if (y == 0 || chunks->get(pos.x, y - 1, pos.z)->id != 0) {
+                    break;
+                }
+            }
+        }
+    }
+    solverR->solve();
+    solverG->solve();
+    solverB->solve();
+    solverS->solve();
+
+    const glm::ivec3 neighbours[] {
+        {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}, {0, 0, 1}, {0, 0, -1}};
+    for (const auto& pos : positions) {
+        voxel* vox = chunks->get(pos.x, pos.y, pos.z);
+        if (vox == nullptr) {
+            continue;
+        }
+        const auto& block = indices->blocks.require(vox->id);
+        if (vox->id == 0) {
+            if (chunks->getLight(pos.x, pos.y + 1, pos.z, 3) == 0xF) {
+                for (int y = pos.y; y >= 0; y--) {
+                    voxel* below = chunks->get(pos.x, y, pos.z);
+                    if (below == nullptr || below->id != 0) {
+                        break;
+                    }
+                    solverS->add(pos.x, y, pos.z, 0xF);
+                }
+            }
+            for (const auto& offset : neighbours) {
+                glm::ivec3 n = pos + offset;
+                solverR->add(n.x, n.y, n.z);
+                solverG->add(n.x, n.y, n.z);
+                solverB->add(n.x, n.y, n.z);
+                solverS->add(n.x, n.y, n.z);
+            }
+        } else if (block.emission[0] || block.emission[1] ||
+                   block.emission[2]) {
+            solverR->add(pos.x, pos.y, pos.z, block.emission[0]);
+            solverG->add(pos.x, pos.y, pos.z, block.emission[1]);
+            solverB->add(pos.x, pos.y, pos.z, block.emission[2]);
+        }
+    }
+    solverR->solve();
+    solverG->solve();
+    solverB->solve();
+    solverS->solve();
+}
@@ -1,6 +1,9 @@
 #ifndef LIGHTING_LIGHTING_HPP_
 #define LIGHTING_LIGHTING_HPP_
 
+#include <vector>
+#include <glm/glm.hpp>
+
 #include <typedefs.hpp>
 
 class Content;
@@ -25,6 +28,10 @@ public:
     void onChunkLoaded(int cx, int cz, bool expand);
     void onBlockSet(int x, int y, int z, blockid_t id);
 
+    /// @brief Update lights after blocks at the positions were set.
+    /// Light removal and propagation are solved once for all of them
+    void onBlocksSet(const std::vector<glm::ivec3>& positions);
+
     static void prebuildSkyLight(Chunk* chunk, const ContentIndices* indices);
 };
 
@@ -0,0 +1,181 @@
+#include "LightingBenchmark.hpp"
+
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <vector>
+
+#include <content/Content.hpp>
+#include <util/timeutil.hpp>
+#include <voxels/Block.hpp>
+#include <voxels/Chunk.hpp>
+#include <voxels/Chunks.hpp>
+#include "Lighting.hpp"
+#include "Lightmap.hpp"
+
+namespace {
+    struct legacyentry {
+        int x;
+        int y;
+        int z;
+        ubyte light;
+    };
+
+    /// @brief Sky light propagation as it was done before LightQueue:
+    /// std::queue frontier of absolute coordinates, chunk is resolved via
+    /// Chunks on every step
+    class LegacySkyLightSolver {
+        static constexpr int channel = 3;
+        std::queue<legacyentry> addqueue;
+        const ContentIndices* const indices;
+        Chunks* chunks;
+    public:
+        LegacySkyLightSolver(const ContentIndices* indices, Chunks* chunks)
+            : indices(indices), chunks(chunks) {
+        }
+
+        void add(int x, int y, int z, int emission) {
+            if (emission <= 1) {
+                return;
+            }
+            addqueue.push(legacyentry {x, y, z, ubyte(emission)});
+
+            Chunk* chunk = chunks->getChunkByVoxel(x, y, z);
+            chunk->flags.modified = true;
+            chunk->lightmap.set(
+                x - chunk->x * CHUNK_W,
+                y,
+                z - chunk->z * CHUNK_D,
+                channel,
+                emission
+            );
+        }
+
+        void add(int x, int y, int z) {
+            add(x, y, z, chunks->getLight(x, y, z, channel));
+        }
+
+        void solve() {
+            const int coords[] = {
+                0, 0, 1, 0, 0, -1, 0, 1, 0, 0, -1, 0, 1, 0, 0, -1, 0, 0};
+            const Block* const* blockDefs = indices->blocks.getDefs();
+            while (!addqueue.empty()) {
+                const legacyentry entry = addqueue.front();
+                addqueue.pop();
+
+                for (int i = 0; i < 6; i++) {
+                    int x = entry.x + coords[i * 3];
+                    int y = entry.y + coords[i * 3 + 1];
+                    int z = entry.z + coords[i * 3 + 2];
+
+                    Chunk* chunk = chunks->getChunkByVoxel(x, y, z);
+                    if (chunk == nullptr) {
+                        continue;
+                    }
+                    int lx = x - chunk->x * CHUNK_W;
+                    int lz = z - chunk->z * CHUNK_D;
+                    chunk->flags.modified = true;
+
+                    ubyte light = chunk->lightmap.get(lx, y, lz, channel);
+                    voxel& v = chunk->voxels[vox_index(lx, y, lz)];
+                    const Block* block = blockDefs[v.id];
+                    if (block->lightPassing && light + 2 <= entry.light) {
+                        chunk->lightmap.set(
+                            lx, y, lz, channel, entry.light - 1
+                        );
+                        addqueue.push(
+                            legacyentry {x, y, z, ubyte(entry.light - 1)}
+                        );
+                    }
+                }
+            }
+        }
+
+        /// @brief Same as Lighting::buildSkyLight
+        void buildSkyLight(int cx, int cz) {
+            const auto blockDefs = indices->blocks.getDefs();
+            Chunk* chunk = chunks->getChunk(cx, cz);
+            for (int z = 0; z < CHUNK_D; z++) {
+                for (int x = 0; x < CHUNK_W; x++) {
+                    int gx = x + cx * CHUNK_W;
+                    int gz = z + cz * CHUNK_D;
+                    for (int y = chunk->lightmap.highestPoint; y >= 0; y--) {
+                        while (y > 0 &&
+                               !blockDefs[chunk->voxels[vox_index(x, y, z)].id]
+                                    ->lightPassing) {
+                            y--;
+                        }
+                        if (chunk->lightmap.getS(x, y, z) != 15) {
+                            add(gx, y + 1, gz);
+                            for (; y >= 0; y--) {
+                                add(gx + 1, y, gz);
+                                add(gx - 1, y, gz);
+                                add(gx, y, gz + 1);
+                                add(gx, y, gz - 1);
+                            }
+                        }
+                    }
+                }
+            }
+            solve();
+        }
+    };
+}
+
+lighting::BenchmarkResult lighting::benchmark_sky_light(
+    const Content* content, Chunks* chunks, int cx, int cz, uint iterations
+) {
+    auto indices = content->getIndices();
+
+    std::vector<Chunk*> area;
+    std::vector<std::unique_ptr<Lightmap>> backups;
+    for (int oz = -1; oz <= 1; oz++) {
+        for (int ox = -1; ox <= 1; ox++) {
+            Chunk* chunk = chunks->getChunk(cx + ox, cz + oz);
+            if (chunk == nullptr) {
+                throw std::runtime_error("chunk neighbourhood is not loaded");
+            }
+            auto backup = std::make_unique<Lightmap>();
+            backup->set(&chunk->lightmap);
+            backup->highestPoint = chunk->lightmap.highestPoint;
+            area.push_back(chunk);
+            backups.push_back(std::move(backup));
+        }
+    }
+    auto restore = [&]() {
+        for (size_t i = 0; i < area.size(); i++) {
+            area[i]->lightmap.set(backups[i].get());
+            area[i]->lightmap.highestPoint = backups[i]->highestPoint;
+            area[i]->flags.modified = true;
+        }
+    };
+    Chunk* chunk = chunks->getChunk(cx, cz);
+    // both solvers start from the same state: sky light of the chunk
+    // is cleared and prebuilt again
+    auto reset = [&]() {
+        restore();
+        auto map = chunk->lightmap.getLightsWriteable();
+        for (int i = 0; i < CHUNK_VOL; i++) {
+            map[i] &= 0x0FFF;
+        }
+        Lighting::prebuildSkyLight(chunk, indices);
+    };
+
+    Lighting current(content, chunks);
+    LegacySkyLightSolver legacy(indices, chunks);
+
+    BenchmarkResult result {};
+    for (uint i = 0; i < iterations; i++) {
+        reset();
+        timeutil::Timer legacyTimer;
+        legacy.buildSkyLight(cx, cz);
+        result.legacy += legacyTimer.stop();
+
+        reset();
+        timeutil::Timer currentTimer;
+        current.buildSkyLight(cx, cz);
+        result.current += currentTimer.stop();
+    }
+    restore();
+    return result;
+}
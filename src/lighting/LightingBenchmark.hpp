@@ -0,0 +1,29 @@
+#ifndef LIGHTING_LIGHTING_BENCHMARK_HPP_
+#define LIGHTING_LIGHTING_BENCHMARK_HPP_
+
+#include <typedefs.hpp>
+
+class Content;
+class Chunks;
+
+namespace lighting {
+    /// @brief Total time of sky light rebuilds in microseconds
+    struct BenchmarkResult {
+        /// @brief std::queue based solver resolving chunks via Chunks
+        int64_t legacy;
+        /// @brief LightSolver
+        int64_t current;
+    };
+
+    /// @brief Rebuild sky light of the chunk repeatedly using the
+    /// previous and the current light solvers.
+    /// Chunk lightmaps are restored after benchmark
+    /// @param cx chunk X
+    /// @param cz chunk Z
+    /// @throws std::runtime_error if chunk 3x3 neighbourhood is not loaded
+    BenchmarkResult benchmark_sky_light(
+        const Content* content, Chunks* chunks, int cx, int cz, uint iterations
+    );
+}
+
+#endif  // LIGHTING_LIGHTING_BENCHMARK_HPP_
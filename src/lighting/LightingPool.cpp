@@ -0,0 +1,67 @@
+#include "LightingPool.hpp"
+
+#include <thread>
+
+#include <voxels/Chunk.hpp>
+#include "Lighting.hpp"
+
+/// @brief Lights are propagated no further than 15 blocks from sources,
+/// so chunk lighting modifies its 3x3 neighbourhood only
+class LightingWorker : public util::Worker<Chunk, std::shared_ptr<Chunk>> {
+    Lighting lighting;
+public:
+    LightingWorker(const Content* content, Chunks* chunks)
+        : lighting(content, chunks) {
+    }
+
+    std::shared_ptr<Chunk> operator()(const std::shared_ptr<Chunk>& chunk
+    ) override {
+        bool lightsCache = chunk->flags.loadedLights;
+        if (!lightsCache) {
+            lighting.buildSkyLight(chunk->x, chunk->z);
+        }
+        lighting.onChunkLoaded(chunk->x, chunk->z, !lightsCache);
+        return chunk;
+    }
+};
+
+LightingPool::LightingPool(const Content* content, Chunks* chunks)
+    : threadPool(
+          "lighting-pool",
+          [=]() { return std::make_shared<LightingWorker>(content, chunks); },
+          [=](std::shared_ptr<Chunk>& chunk) {
+              chunk->flags.lighted = true;
+              remaining--;
+          }
+      ),
+      localWorker(std::make_shared<LightingWorker>(content, chunks)) {
+    // main thread is waiting for the batch
+    threadPool.setPriority(util::JobPriority::high);
+}
+
+LightingPool::~LightingPool() = default;
+
+void LightingPool::build(const std::vector<std::shared_ptr<Chunk>>& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    remaining = batch.size() - 1;
+    for (size_t i = 1; i < batch.size(); i++) {
+        threadPool.enqueueJob(batch[i]);
+    }
+    (*localWorker)(batch[0])->flags.lighted = true;
+
+    // workers may be busy with long jobs like chunks generation,
+    // so lighting jobs not taken yet are executed here
+    auto& jobSystem = util::JobSystem::getInstance();
+    while (remaining) {
+        threadPool.update();
+        if (remaining && !jobSystem.executeQueued(util::JobPriority::high)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+uint LightingPool::getWorkersCount() const {
+    return threadPool.getWorkersCount() + 1;
+}
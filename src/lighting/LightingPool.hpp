@@ -0,0 +1,37 @@
+#ifndef LIGHTING_LIGHTING_POOL_HPP_
+#define LIGHTING_LIGHTING_POOL_HPP_
+
+#include <memory>
+#include <vector>
+
+#include <typedefs.hpp>
+#include <util/ThreadPool.hpp>
+
+class Content;
+class Chunk;
+class Chunks;
+class LightingWorker;
+
+/// @brief Builds lights of chunks batches on worker threads.
+/// Every worker owns its own light solvers
+class LightingPool {
+    util::ThreadPool<Chunk, std::shared_ptr<Chunk>> threadPool;
+    /// @brief Worker used by the thread calling build
+    std::shared_ptr<LightingWorker> localWorker;
+    size_t remaining = 0;
+public:
+    LightingPool(const Content* content, Chunks* chunks);
+    ~LightingPool();
+
+    /// @brief Build lights for all given chunks, blocks until done.
+    /// Each chunk must have all 3x3 neighbourhood loaded and
+    /// neighbourhoods of the batch chunks must not overlap.
+    /// The first chunk is lighted on the calling thread, which executes
+    /// queued lighting jobs too instead of waiting for busy workers
+    void build(const std::vector<std::shared_ptr<Chunk>>& batch);
+
+    /// @return max number of chunks lighted at once
+    uint getWorkersCount() const;
+};
+
+#endif  // LIGHTING_LIGHTING_POOL_HPP_
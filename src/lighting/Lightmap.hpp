@@ -67,6 +67,15 @@ public:
         map[index] = (map[index] & (0xFFFF & (~(0xF << (channel*4))))) | (value << (channel << 2));
     }
 
+    inline unsigned char get(uint index, int channel) const {
+        return (map[index] >> (channel << 2)) & 0xF;
+    }
+
+    inline void set(uint index, int channel, int value) {
+        map[index] = (map[index] & (0xFFFF & (~(0xF << (channel * 4))))) |
+                     (value << (channel << 2));
+    }
+
     inline const light_t* getLights() const {
         return map;
     }
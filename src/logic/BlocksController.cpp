@@ -1,5 +1,8 @@
 #include "BlocksController.hpp"
 
+#include <algorithm>
+#include <unordered_set>
+
 #include <content/Content.hpp>
 #include <items/Inventories.hpp>
 #include <items/Inventory.hpp>
@@ -14,23 +17,59 @@
 #include <world/World.hpp>
 #include "scripting/scripting.hpp"
 
-BlocksController::BlocksController(Level* level, uint padding)
+BlocksController::BlocksController(
+    Level* level, uint padding, uint updatesBudget
+)
     : level(level),
       chunks(level->chunks.get()),
       lighting(level->lighting.get()),
       randTickClock(20, 3),
       blocksTickClock(20, 1),
       worldTickClock(20, 1),
-      padding(padding) {
+      padding(padding),
+      updatesBudget(updatesBudget) {
 }
 
 void BlocksController::updateSides(int x, int y, int z) {
-    updateBlock(x - 1, y, z);
-    updateBlock(x + 1, y, z);
-    updateBlock(x, y - 1, z);
-    updateBlock(x, y + 1, z);
-    updateBlock(x, y, z - 1);
-    updateBlock(x, y, z + 1);
+    scheduleUpdate(x - 1, y, z);
+    scheduleUpdate(x + 1, y, z);
+    scheduleUpdate(x, y - 1, z);
+    scheduleUpdate(x, y + 1, z);
+    scheduleUpdate(x, y, z - 1);
+    scheduleUpdate(x, y, z + 1);
+}
+
+void BlocksController::scheduleUpdate(int x, int y, int z, uint delay) {
+    glm::ivec3 pos(x, y, z);
+    uint64_t tick = blocksTick + std::max(1u, delay);
+    auto found = scheduledUpdates.find(pos);
+    if (found != scheduledUpdates.end()) {
+        if (found->second <= tick) {
+            return;
+        }
+        found->second = tick;
+    } else {
+        scheduledUpdates[pos] = tick;
+    }
+    updatesQueue.push(ScheduledUpdate {tick, updatesCounter++, pos});
+}
+
+void BlocksController::updateScheduled() {
+    uint processed = 0;
+    while (!updatesQueue.empty() && processed < updatesBudget) {
+        auto update = updatesQueue.top();
+        if (update.tick > blocksTick) {
+            break;
+        }
+        updatesQueue.pop();
+        auto found = scheduledUpdates.find(update.pos);
+        if (found == scheduledUpdates.end() || found->second != update.tick) {
+            continue;
+        }
+        scheduledUpdates.erase(found);
+        updateBlock(update.pos.x, update.pos.y, update.pos.z);
+        processed++;
+    }
 }
 
 void BlocksController::breakBlock(
@@ -75,11 +114,45 @@ void BlocksController::updateBlock(int x, int y, int z) {
     }
 }
 
+void BlocksController::setBlocks(
+    const std::vector<BlockEdit>& edits, bool update
+) {
+    std::vector<glm::ivec3> positions;
+    positions.reserve(edits.size());
+    std::unordered_set<Chunk*> touched;
+    Chunk* lastChunk = nullptr;
+    for (const auto& edit : edits) {
+        const auto& pos = edit.pos;
+        Chunk* chunk = chunks->getChunkByVoxel(pos.x, pos.y, pos.z);
+        if (chunk == nullptr) {
+            continue;
+        }
+        if (chunk != lastChunk) {
+            touched.insert(chunk);
+            lastChunk = chunk;
+        }
+        chunks->set(pos.x, pos.y, pos.z, edit.id, edit.state, false);
+        positions.push_back(pos);
+    }
+    for (auto chunk : touched) {
+        chunk->updateHeights();
+    }
+    lighting->onBlocksSet(positions);
+    if (update) {
+        for (const auto& pos : positions) {
+            updateSides(pos.x, pos.y, pos.z);
+        }
+    }
+}
+
 void BlocksController::update(float delta) {
     if (randTickClock.update(delta)) {
         randomTick(randTickClock.getPart(), randTickClock.getParts());
     }
     if (blocksTickClock.update(delta)) {
+        blocksTick++;
+        // updates left over budget are processed on the next ticks first
+        updateScheduled();
         onBlocksTick(blocksTickClock.getPart(), blocksTickClock.getParts());
     }
     if (worldTickClock.update(delta)) {
@@ -101,32 +174,82 @@ void BlocksController::onBlocksTick(int tickid, int parts) {
     }
 }
 
+/// @brief Probability of a block to be updated on a random tick:
+/// 4 samples per 64 blocks high chunk segment
+static constexpr float RANDOM_TICK_DENSITY = 4.0f / (CHUNK_W * 64 * CHUNK_D);
+
+static void build_tick_index(Chunk& chunk, const ContentIndices* indices) {
+    auto defs = indices->blocks.getDefs();
+    chunk.tickables = std::make_unique<RandomTickIndex>();
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        if (defs[chunk.voxels[i].id]->rt.funcsset.randupdate) {
+            chunk.tickables->add(i);
+        }
+    }
+}
+
 void BlocksController::randomTick(
-    const Chunk& chunk, int segments, const ContentIndices* indices
+    Chunk& chunk, const ContentIndices* indices
 ) {
-    const int segheight = CHUNK_H / segments;
-
-    for (int s = 0; s < segments; s++) {
-        for (int i = 0; i < 4; i++) {
-            int bx = random.rand() % CHUNK_W;
-            int by = random.rand() % segheight + s * segheight;
-            int bz = random.rand() % CHUNK_D;
-            const voxel& vox = chunk.voxels[(by * CHUNK_D + bz) * CHUNK_W + bx];
-            auto& block = indices->blocks.require(vox.id);
-            if (block.rt.funcsset.randupdate) {
-                scripting::random_update_block(
-                    block, chunk.x * CHUNK_W + bx, by, chunk.z * CHUNK_D + bz
-                );
+    if (chunk.tickables == nullptr) {
+        build_tick_index(chunk, indices);
+    }
+    for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        // updates may modify the index
+        const auto& positions = chunk.tickables->sections[s];
+        if (positions.empty()) {
+            continue;
+        }
+        float expected = positions.size() * RANDOM_TICK_DENSITY;
+        int ticks = static_cast<int>(expected);
+        if (random.randFloat() < expected - ticks) {
+            ticks++;
+        }
+        for (int i = 0; i < ticks && !positions.empty(); i++) {
+            uint index = positions[random.rand() % positions.size()];
+            int bx = index % CHUNK_W;
+            int bz = index / CHUNK_W % CHUNK_D;
+            int by = index / (CHUNK_W * CHUNK_D);
+            randomUpdates.push_back(RandomUpdate {
+                chunk.voxels[index].id,
+                glm::ivec3(chunk.x * CHUNK_W + bx, by, chunk.z * CHUNK_D + bz)});
+        }
+    }
+}
+
+void BlocksController::emitRandomUpdates(const ContentIndices* indices) {
+    std::stable_sort(
+        randomUpdates.begin(),
+        randomUpdates.end(),
+        [](const auto& a, const auto& b) { return a.id < b.id; }
+    );
+    for (size_t i = 0; i < randomUpdates.size();) {
+        blockid_t id = randomUpdates[i].id;
+        randomUpdatesPositions.clear();
+        for (; i < randomUpdates.size() && randomUpdates[i].id == id; i++) {
+            const auto& pos = randomUpdates[i].pos;
+            // skip blocks replaced by previous updates
+            auto vox = chunks->get(pos.x, pos.y, pos.z);
+            if (vox && vox->id == id) {
+                randomUpdatesPositions.push_back(pos);
             }
         }
+        if (randomUpdatesPositions.empty()) {
+            continue;
+        }
+        scripting::random_update_blocks(
+            indices->blocks.require(id),
+            randomUpdatesPositions.data(),
+            randomUpdatesPositions.size()
+        );
     }
+    randomUpdates.clear();
 }
 
 void BlocksController::randomTick(int tickid, int parts) {
     auto indices = level->content->getIndices();
     const int w = chunks->w;
     const int d = chunks->d;
-    int segments = 4;
 
     for (uint z = padding; z < d - padding; z++) {
         for (uint x = padding; x < w - padding; x++) {
@@ -138,9 +261,10 @@ void BlocksController::randomTick(int tickid, int parts) {
             if (chunk == nullptr || !chunk->flags.lighted) {
                 continue;
             }
-            randomTick(*chunk, segments, indices);
+            randomTick(*chunk, indices);
         }
     }
+    emitRandomUpdates(indices);
 }
 
 int64_t BlocksController::createBlockInventory(int x, int y, int z) {
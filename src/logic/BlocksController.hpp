@@ -3,12 +3,18 @@
 
 #include <functional>
 #include <glm/glm.hpp>
+#include <queue>
+#include <unordered_map>
+#include <vector>
 
 #include <maths/fastmaths.hpp>
 #include <typedefs.hpp>
 #include <util/Clock.hpp>
 #include <voxels/voxel.hpp>
 
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
 class Player;
 class Block;
 class Level;
@@ -19,12 +25,34 @@ class ContentIndices;
 
 enum class BlockInteraction { step, destruction, placing };
 
+/// @brief Single block write of a batch edit
+struct BlockEdit {
+    glm::ivec3 pos;
+    blockid_t id;
+    blockstate state;
+};
+
 /// @brief Player argument is nullable
 using on_block_interaction = std::function<
     void(Player*, glm::ivec3, const Block&, BlockInteraction type)>;
 
 /// BlocksController manages block updates and data (inventories, metadata)
 class BlocksController {
+    struct ScheduledUpdate {
+        uint64_t tick;
+        uint64_t order;
+        glm::ivec3 pos;
+
+        bool operator>(const ScheduledUpdate& other) const {
+            return tick > other.tick ||
+                   (tick == other.tick && order > other.order);
+        }
+    };
+    struct RandomUpdate {
+        blockid_t id;
+        glm::ivec3 pos;
+    };
+
     Level* level;
     Chunks* chunks;
     Lighting* lighting;
@@ -34,21 +62,56 @@ class BlocksController {
     uint padding;
     FastRandom random;
     std::vector<on_block_interaction> blockInteractionCallbacks;
+    /// @brief Blocks ticks passed since the controller creation
+    uint64_t blocksTick = 0;
+    uint64_t updatesCounter = 0;
+    /// @brief Max number of scheduled updates processed per blocks tick
+    uint updatesBudget;
+    std::priority_queue<
+        ScheduledUpdate,
+        std::vector<ScheduledUpdate>,
+        std::greater<ScheduledUpdate>>
+        updatesQueue;
+    /// @brief Target tick of the update scheduled for the position.
+    /// Queue entries not matching it are outdated
+    std::unordered_map<glm::ivec3, uint64_t> scheduledUpdates;
+    /// @brief Random updates of the current tick, emitted grouped by block
+    std::vector<RandomUpdate> randomUpdates;
+    std::vector<glm::ivec3> randomUpdatesPositions;
+
+    void updateScheduled();
+    /// @brief Select random updates of the chunk blocks
+    void randomTick(Chunk& chunk, const ContentIndices* indices);
+    void emitRandomUpdates(const ContentIndices* indices);
 public:
-    BlocksController(Level* level, uint padding);
+    BlocksController(Level* level, uint padding, uint updatesBudget);
 
+    /// @brief Schedule update of the neighbour blocks
     void updateSides(int x, int y, int z);
     void updateBlock(int x, int y, int z);
 
+    /// @brief Set many blocks at once. Lights are updated with a single
+    /// pass, heights of each touched chunk are recalculated once.
+    /// Edits in unloaded chunks are skipped
+    /// @param update schedule updates of the blocks neighbours
+    void setBlocks(const std::vector<BlockEdit>& edits, bool update = true);
+
+    /// @brief Schedule block update. Updates of the same position are
+    /// merged into the earliest one
+    /// @param delay number of blocks ticks (20 per second) to wait,
+    /// at least one
+    void scheduleUpdate(int x, int y, int z, uint delay = 1);
+
+    size_t getScheduledUpdatesCount() const {
+        return scheduledUpdates.size();
+    }
+
     void breakBlock(Player* player, const Block& def, int x, int y, int z);
     void placeBlock(
         Player* player, const Block& def, blockstate state, int x, int y, int z
     );
 
     void update(float delta);
-    void randomTick(
-        const Chunk& chunk, int segments, const ContentIndices* indices
-    );
     void randomTick(int tickid, int parts);
     void onBlocksTick(int tickid, int parts);
     int64_t createBlockInventory(int x, int y, int z);
@@ -2,13 +2,18 @@
 
 #include <limits.h>
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 #include <content/Content.hpp>
+#include <data/dynamic.hpp>
+#include <debug/Logger.hpp>
 #include <files/WorldFiles.hpp>
 #include <graphics/core/Mesh.hpp>
 #include <lighting/Lighting.hpp>
+#include <lighting/LightingPool.hpp>
 #include <maths/voxmaths.hpp>
 #include <util/timeutil.hpp>
 #include <voxels/Block.hpp>
@@ -20,27 +25,106 @@
 #include <world/World.hpp>
 #include <world/WorldGenerators.hpp>
 
+static debug::Logger logger("chunks-control");
+
 const uint MAX_WORK_PER_FRAME = 128;
 const uint MIN_SURROUNDING = 9;
+/// @brief Max number of requested chunks per loader worker
+const uint MAX_PENDING_PER_WORKER = 2;
+
+/// @brief Reads chunk from regions or generates it,
+/// also prebuilds sky light when no lights cache available
+class ChunksLoaderWorker : public util::Worker<glm::ivec2, LoadedChunk> {
+    Level* level;
+    std::unique_ptr<WorldGenerator> generator;
+public:
+    ChunksLoaderWorker(Level* level)
+        : level(level),
+          generator(WorldGenerators::createGenerator(
+              level->getWorld()->getGenerator(), level->content
+          )) {
+    }
+
+    LoadedChunk operator()(const std::shared_ptr<glm::ivec2>& pos) override {
+        LoadedChunk loaded {};
+        std::shared_ptr<Chunk> chunk;
+        bool corrupted = false;
+        try {
+            chunk = level->chunksStorage->read(pos->x, pos->y, loaded.entities);
+        } catch (const std::exception& err) {
+            // one broken chunk must not stop the loader
+            logger.error() << "could not read chunk " << pos->x << " "
+                           << pos->y << ": " << err.what();
+            loaded.entities = nullptr;
+            chunk = std::make_shared<Chunk>(pos->x, pos->y);
+            corrupted = true;
+        }
+        auto& chunkFlags = chunk->flags;
+
+        if (!chunkFlags.loaded) {
+            // stored data is kept until the chunk is modified
+            chunkFlags.unsaved = generate(*chunk) && !corrupted;
+        }
+        chunk->updateHeights();
+
+        if (!chunkFlags.loadedLights) {
+            Lighting::prebuildSkyLight(
+                chunk.get(), level->content->getIndices()
+            );
+        }
+        chunkFlags.loaded = true;
+        chunkFlags.ready = true;
+        loaded.chunk = std::move(chunk);
+        return loaded;
+    }
+private:
+    /// @brief Generate chunk voxels, leaving it empty if generator fails,
+    /// so the position does not stay pending forever
+    /// @return false if generator failed
+    bool generate(Chunk& chunk) {
+        try {
+            generator->generate(
+                chunk.voxels, chunk.x, chunk.z, level->getWorld()->getSeed()
+            );
+            return true;
+        } catch (const std::exception& err) {
+            logger.error() << "could not generate chunk " << chunk.x << " "
+                           << chunk.z << ": " << err.what();
+            std::fill(
+                std::begin(chunk.voxels), std::end(chunk.voxels), voxel {}
+            );
+            return false;
+        }
+    }
+};
 
 ChunksController::ChunksController(Level* level, uint padding)
     : level(level),
       chunks(level->chunks.get()),
-      lighting(level->lighting.get()),
       padding(padding),
-      generator(WorldGenerators::createGenerator(
-          level->getWorld()->getGenerator(), level->content
-      )) {
+      loader(
+          "chunks-loader-pool",
+          [=]() { return std::make_shared<ChunksLoaderWorker>(level); },
+          [=](LoadedChunk& loaded) { installChunk(loaded); }
+      ),
+      lightingPool(
+          std::make_unique<LightingPool>(level->content, level->chunks.get())
+      ) {
+    // meshing of loaded chunks goes first
+    loader.setPriority(util::JobPriority::low);
+    logger.info() << "created " << loader.getWorkersCount() << " workers";
 }
 
 ChunksController::~ChunksController() = default;
 
 void ChunksController::update(int64_t maxDuration) {
+    loader.update();
+
     int64_t mcstotal = 0;
 
     for (uint i = 0; i < MAX_WORK_PER_FRAME; i++) {
         timeutil::Timer timer;
-        if (loadVisible()) {
+        if (buildLights() || loadVisible()) {
             int64_t mcs = timer.stop();
             if (mcstotal + mcs < maxDuration * 1000) {
                 mcstotal += mcs;
@@ -51,80 +135,156 @@ void ChunksController::update(int64_t maxDuration) {
     }
 }
 
-bool ChunksController::loadVisible() {
+void ChunksController::updateLoadOrder() {
     const int w = chunks->w;
     const int d = chunks->d;
-
-    int nearX = 0;
-    int nearZ = 0;
-    int minDistance = ((w - padding * 2) / 2) * ((w - padding * 2) / 2);
-    for (uint z = padding; z < d - padding; z++) {
-        for (uint x = padding; x < w - padding; x++) {
-            int index = z * w + x;
-            auto& chunk = chunks->chunks[index];
-            if (chunk != nullptr) {
-                if (chunk->flags.loaded && !chunk->flags.lighted) {
-                    if (buildLights(chunk)) {
-                        return true;
-                    }
-                }
-                continue;
-            }
-            int lx = x - w / 2;
-            int lz = z - d / 2;
-            int distance = (lx * lx + lz * lz);
-            if (distance < minDistance) {
-                minDistance = distance;
-                nearX = x;
-                nearZ = z;
+    if (loadOrderW != chunks->w || loadOrderD != chunks->d) {
+        loadOrder.clear();
+        for (int z = padding; z < d - int(padding); z++) {
+            for (int x = padding; x < w - int(padding); x++) {
+                loadOrder.emplace_back(x - w / 2, z - d / 2);
             }
         }
+        std::stable_sort(
+            loadOrder.begin(),
+            loadOrder.end(),
+            [](const auto& a, const auto& b) {
+                return a.x * a.x + a.y * a.y < b.x * b.x + b.y * b.y;
+            }
+        );
+        loadOrderW = chunks->w;
+        loadOrderD = chunks->d;
+        loadCursor = 0;
     }
-
-    const auto& chunk = chunks->chunks[nearZ * w + nearX];
-    if (chunk != nullptr) {
-        return false;
+    if (loadRevision != chunks->revision) {
+        loadRevision = chunks->revision;
+        loadCursor = 0;
     }
+}
 
+bool ChunksController::loadVisible() {
+    updateLoadOrder();
+
+    const int w = chunks->w;
+    const int d = chunks->d;
     const int ox = chunks->ox;
     const int oz = chunks->oz;
-    createChunk(nearX + ox, nearZ + oz);
-    return true;
-}
+    const int maxDistance = ((w - padding * 2) / 2) * ((w - padding * 2) / 2);
 
-bool ChunksController::buildLights(const std::shared_ptr<Chunk>& chunk) {
-    int surrounding = 0;
-    for (int oz = -1; oz <= 1; oz++) {
-        for (int ox = -1; ox <= 1; ox++) {
-            if (chunks->getChunk(chunk->x + ox, chunk->z + oz)) surrounding++;
+    // chunks are only added between matrix changes,
+    // so skipped positions stay loaded or pending
+    for (; loadCursor < loadOrder.size(); loadCursor++) {
+        const auto& pos = loadOrder[loadCursor];
+        if (pos.x * pos.x + pos.y * pos.y >= maxDistance) {
+            loadCursor = loadOrder.size();
+            return false;
         }
-    }
-    if (surrounding == MIN_SURROUNDING) {
-        bool lightsCache = chunk->flags.loadedLights;
-        if (!lightsCache) {
-            lighting->buildSkyLight(chunk->x, chunk->z);
+        int x = pos.x + w / 2;
+        int z = pos.y + d / 2;
+        if (chunks->chunks[z * w + x] != nullptr ||
+            pending.find(glm::ivec2(x + ox, z + oz)) != pending.end()) {
+            continue;
+        }
+        if (pending.size() >=
+            loader.getWorkersCount() * MAX_PENDING_PER_WORKER) {
+            return false;
         }
-        lighting->onChunkLoaded(chunk->x, chunk->z, !lightsCache);
-        chunk->flags.lighted = true;
+        requestChunk(x + ox, z + oz);
+        loadCursor++;
         return true;
     }
     return false;
 }
 
-void ChunksController::createChunk(int x, int z) {
-    auto chunk = level->chunksStorage->create(x, z);
-    chunks->putChunk(chunk);
-    auto& chunkFlags = chunk->flags;
+bool ChunksController::buildLights() {
+    const int w = chunks->w;
+    const int d = chunks->d;
 
-    if (!chunkFlags.loaded) {
-        generator->generate(chunk->voxels, x, z, level->getWorld()->getSeed());
-        chunkFlags.unsaved = true;
+    std::vector<std::pair<int, std::shared_ptr<Chunk>>> candidates;
+    for (size_t i = 0; i < unlighted.size();) {
+        const auto chunk = unlighted[i];
+        int x = chunk->x - chunks->ox;
+        int z = chunk->z - chunks->oz;
+        if (chunk->flags.lighted || x < 0 || z < 0 || x >= w || z >= d ||
+            chunks->chunks[z * w + x] != chunk) {
+            // lighted or removed from the matrix
+            unlighted[i] = std::move(unlighted.back());
+            unlighted.pop_back();
+            continue;
+        }
+        i++;
+        if (x < int(padding) || z < int(padding) || x >= w - int(padding) ||
+            z >= d - int(padding)) {
+            continue;
+        }
+        int surrounding = 0;
+        for (int oz = -1; oz <= 1; oz++) {
+            for (int ox = -1; ox <= 1; ox++) {
+                if (chunks->getChunk(chunk->x + ox, chunk->z + oz)) {
+                    surrounding++;
+                }
+            }
+        }
+        if (surrounding == MIN_SURROUNDING) {
+            int lx = x - w / 2;
+            int lz = z - d / 2;
+            candidates.emplace_back(lx * lx + lz * lz, chunk);
+        }
     }
-    chunk->updateHeights();
+    if (candidates.empty()) {
+        return false;
+    }
+    std::sort(
+        candidates.begin(),
+        candidates.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; }
+    );
+
+    // lighting a chunk modifies its 3x3 neighbourhood, so chunks lighted
+    // concurrently must be at least 3 chunks away from each other
+    uint maxBatch = lightingPool->getWorkersCount();
+    std::vector<std::shared_ptr<Chunk>> batch;
+    for (const auto& [distance, chunk] : candidates) {
+        bool overlaps = false;
+        for (const auto& other : batch) {
+            if (std::abs(chunk->x - other->x) < 3 &&
+                std::abs(chunk->z - other->z) < 3) {
+                overlaps = true;
+                break;
+            }
+        }
+        if (!overlaps) {
+            batch.push_back(chunk);
+            if (batch.size() >= maxBatch) {
+                break;
+            }
+        }
+    }
+    lightingPool->build(batch);
+    return true;
+}
+
+void ChunksController::requestChunk(int x, int z) {
+    LoadedChunk resident {};
+    if ((resident.chunk =
+             level->chunksStorage->acquire(x, z, resident.entities))) {
+        // lights are kept, but must be spread to the new neighbours
+        resident.chunk->flags.lighted = false;
+        resident.chunk->flags.loadedLights = true;
+        installChunk(resident);
+        return;
+    }
+    pending.insert(glm::ivec2(x, z));
+    loader.enqueueJob(std::make_shared<glm::ivec2>(x, z));
+}
 
-    if (!chunkFlags.loadedLights) {
-        Lighting::prebuildSkyLight(chunk.get(), level->content->getIndices());
+void ChunksController::installChunk(LoadedChunk& loaded) {
+    auto& chunk = loaded.chunk;
+    pending.erase(glm::ivec2(chunk->x, chunk->z));
+    // chunk is out of the loading zone already, will be requested again
+    if (!chunks->putChunk(chunk)) {
+        return;
     }
-    chunkFlags.loaded = true;
-    chunkFlags.ready = true;
+    level->chunksStorage->install(chunk, std::move(loaded.entities));
+    unlighted.push_back(chunk);
 }
@@ -2,28 +2,60 @@
 #define VOXELS_CHUNKSCONTROLLER_HPP_
 
 #include <memory>
+#include <unordered_set>
+#include <vector>
 
+#include <data/dynamic_fwd.hpp>
 #include <typedefs.hpp>
+#include <util/ThreadPool.hpp>
+#include <voxels/ChunksStorage.hpp>
 
 class Level;
 class Chunk;
 class Chunks;
-class Lighting;
-class WorldGenerator;
+class LightingPool;
+
+/// @brief Chunk loaded or generated by a loader worker,
+/// waiting to be installed into the level on the main thread
+struct LoadedChunk {
+    std::shared_ptr<Chunk> chunk;
+    dynamic::Map_sptr entities;
+};
 
 /// @brief ChunksController manages chunks dynamic loading/unloading
 class ChunksController {
 private:
     Level* level;
     Chunks* chunks;
-    Lighting* lighting;
     uint padding;
-    std::unique_ptr<WorldGenerator> generator;
+    /// @brief Chunks requested from loader workers but not installed yet
+    std::unordered_set<glm::ivec2> pending;
+    /// @brief Installed chunks not lighted yet, may contain chunks
+    /// removed from the matrix
+    std::vector<std::shared_ptr<Chunk>> unlighted;
+    /// @brief Loading area positions relative to the matrix center
+    /// sorted by distance
+    std::vector<glm::ivec2> loadOrder;
+    /// @brief loadOrder positions before cursor are loaded or pending
+    size_t loadCursor = 0;
+    /// @brief Chunks matrix size and revision loadOrder and loadCursor
+    /// are valid for
+    uint32_t loadOrderW = 0, loadOrderD = 0;
+    uint64_t loadRevision = 0;
+
+    util::ThreadPool<glm::ivec2, LoadedChunk> loader;
+    std::unique_ptr<LightingPool> lightingPool;
 
-    /// @brief Process one chunk: load it or calculate lights for it
+    /// @brief Rebuild load order if chunks matrix is resized,
+    /// rewind cursor if chunks are moved or removed
+    void updateLoadOrder();
+    /// @brief Request the nearest missing chunk from loader
     bool loadVisible();
-    bool buildLights(const std::shared_ptr<Chunk>& chunk);
-    void createChunk(int x, int y);
+    /// @brief Build lights for a batch of loaded chunks having
+    /// non-overlapping 3x3 neighbourhoods
+    bool buildLights();
+    void requestChunk(int x, int z);
+    void installChunk(LoadedChunk& loaded);
 public:
     ChunksController(Level* level, uint padding);
     ~ChunksController();
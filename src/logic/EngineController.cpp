@@ -63,23 +63,11 @@ std::shared_ptr<Task> create_converter(
     );
 }
 
-void show_convert_request(
-    Engine* engine,
-    const Content* content,
-    const std::shared_ptr<ContentLUT>& lut,
-    const fs::path& folder,
-    const runnable& postRunnable
-) {
+void show_convert_request(Engine* engine, const runnable& onAccept) {
     guiutil::confirm(
         engine->getGUI(),
         langs::get(L"world.convert-request"),
-        [=]() {
-            auto converter =
-                create_converter(engine, folder, content, lut, postRunnable);
-            menus::show_process_panel(
-                engine, converter, L"Converting world..."
-            );
-        },
+        onAccept,
         L"",
         langs::get(L"Cancel")
     );
@@ -134,13 +122,29 @@ void EngineController::openWorld(const std::string& name, bool confirmConvert) {
 
     auto* content = engine->getContent();
 
-    std::shared_ptr<ContentLUT> lut(World::checkIndices(folder, content));
+    std::shared_ptr<ContentLUT> lut;
+    try {
+        lut = World::checkIndices(folder, content);
+    } catch (const world_load_error& error) {
+        guiutil::alert(
+            engine->getGUI(),
+            langs::get(L"Error") + L": " + util::str2wstr_utf8(error.what())
+        );
+        return;
+    }
     if (lut) {
         if (lut->hasMissingContent()) {
             engine->setScreen(std::make_shared<MenuScreen>(engine));
             show_content_missing(engine, lut);
         } else {
-            if (confirmConvert) {
+            // lazy conversion rewrites indices and player files too,
+            // so it's started only when the conversion is accepted
+            auto convert = [=]() {
+                if (engine->getSettings().chunks.lazyRemap.get() &&
+                    WorldConverter::startRemap(folder, content, lut)) {
+                    loadWorld(engine, folder);
+                    return;
+                }
                 menus::show_process_panel(
                     engine,
                     create_converter(
@@ -152,10 +156,11 @@ void EngineController::openWorld(const std::string& name, bool confirmConvert) {
                     ),
                     L"Converting world..."
                 );
+            };
+            if (confirmConvert) {
+                convert();
             } else {
-                show_convert_request(engine, content, lut, folder, [=]() {
-                    openWorld(name, false);
-                });
+                show_convert_request(engine, convert);
             }
         }
     } else {
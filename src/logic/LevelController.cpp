@@ -20,7 +20,9 @@ LevelController::LevelController(
     : settings(settings),
       level(std::move(level)),
       blocks(std::make_unique<BlocksController>(
-          this->level.get(), settings.chunks.padding.get()
+          this->level.get(),
+          settings.chunks.padding.get(),
+          settings.chunks.blockUpdates.get()
       )),
       chunks(std::make_unique<ChunksController>(
           this->level.get(), settings.chunks.padding.get()
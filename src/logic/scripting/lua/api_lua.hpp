@@ -16,6 +16,7 @@
 
 // Libraries
 extern const luaL_Reg audiolib[];
+extern const luaL_Reg benchlib[];
 extern const luaL_Reg blocklib[];
 extern const luaL_Reg cameralib[];
 extern const luaL_Reg consolelib[];
@@ -12,6 +12,7 @@ static int l_set_pos(lua::State* L) {
         auto vec = lua::tovec3(L, 2);
         entity->getTransform().setPos(vec);
         entity->getRigidbody().hitbox.position = vec;
+        scripting::controller->getLevel()->entities->markMoved();
     }
     return 0;
 }
@@ -0,0 +1,58 @@
+#include <constants.hpp>
+#include <files/CodecBenchmark.hpp>
+#include <lighting/LightingBenchmark.hpp>
+#include <maths/voxmaths.hpp>
+#include <voxels/Chunk.hpp>
+#include <voxels/Chunks.hpp>
+#include <world/Level.hpp>
+#include "api_lua.hpp"
+
+using namespace scripting;
+
+static int l_bench_lights(lua::State* L) {
+    int x = lua::tointeger(L, 1);
+    int z = lua::tointeger(L, 2);
+    uint iterations = lua::tointeger(L, 3);
+    auto result = lighting::benchmark_sky_light(
+        content,
+        level->chunks.get(),
+        floordiv(x, CHUNK_W),
+        floordiv(z, CHUNK_D),
+        iterations
+    );
+    lua::createtable(L, 0, 2);
+    lua::pushinteger(L, result.legacy);
+    lua::setfield(L, "legacy");
+    lua::pushinteger(L, result.current);
+    lua::setfield(L, "current");
+    return 1;
+}
+
+static int l_bench_codecs(lua::State* L) {
+    int x = lua::tointeger(L, 1);
+    int z = lua::tointeger(L, 2);
+    uint iterations = lua::tointeger(L, 3);
+    auto chunk =
+        level->chunks->getChunk(floordiv(x, CHUNK_W), floordiv(z, CHUNK_D));
+    if (chunk == nullptr) {
+        throw std::runtime_error("chunk is not loaded");
+    }
+    auto results = files::benchmark_codecs(*chunk, iterations);
+    lua::createtable(L, 0, results.size());
+    for (const auto& result : results) {
+        lua::createtable(L, 0, 3);
+        lua::pushinteger(L, result.size);
+        lua::setfield(L, "size");
+        lua::pushinteger(L, result.encode);
+        lua::setfield(L, "encode");
+        lua::pushinteger(L, result.decode);
+        lua::setfield(L, "decode");
+        lua::setfield(L, to_string(result.codec));
+    }
+    return 1;
+}
+
+const luaL_Reg benchlib[] = {
+    {"lights", lua::wrap<l_bench_lights>},
+    {"codecs", lua::wrap<l_bench_codecs>},
+    {NULL, NULL}};
@@ -2,6 +2,7 @@
 #include <lighting/Lighting.hpp>
 #include <logic/BlocksController.hpp>
 #include <logic/LevelController.hpp>
+#include <maths/voxmaths.hpp>
 #include <voxels/Block.hpp>
 #include <voxels/Chunk.hpp>
 #include <voxels/Chunks.hpp>
@@ -102,6 +103,93 @@ static int l_set(lua::State* L) {
     return 0;
 }
 
+static int l_fill(lua::State* L) {
+    auto a = lua::tovec<3>(L, 1);
+    auto b = lua::tovec<3>(L, 2);
+    auto id = lua::tointeger(L, 3);
+    auto state = lua::gettop(L) >= 4 ? lua::tointeger(L, 4) : 0;
+    bool noupdate = lua::toboolean(L, 5);
+    if (static_cast<size_t>(id) >= indices->blocks.count()) {
+        return 0;
+    }
+    // blocks outside of the loaded chunks are skipped anyway
+    const auto& chunks = *level->chunks;
+    glm::vec3 minPos(chunks.ox * CHUNK_W, 0, chunks.oz * CHUNK_D);
+    glm::vec3 maxPos(
+        (chunks.ox + static_cast<int>(chunks.w)) * CHUNK_W - 1,
+        CHUNK_H - 1,
+        (chunks.oz + static_cast<int>(chunks.d)) * CHUNK_D - 1
+    );
+    glm::ivec3 start = glm::floor(glm::max(glm::min(a, b), minPos));
+    glm::ivec3 end = glm::floor(glm::min(glm::max(a, b), maxPos));
+    if (start.x > end.x || start.y > end.y || start.z > end.z) {
+        return 0;
+    }
+
+    // edits are set chunk by chunk, so no more than CHUNK_VOL are kept
+    std::vector<BlockEdit> edits;
+    for (int cz = floordiv(start.z, CHUNK_D); cz <= floordiv(end.z, CHUNK_D);
+         cz++) {
+        for (int cx = floordiv(start.x, CHUNK_W);
+             cx <= floordiv(end.x, CHUNK_W);
+             cx++) {
+            glm::ivec3 from(
+                std::max(start.x, cx * CHUNK_W),
+                start.y,
+                std::max(start.z, cz * CHUNK_D)
+            );
+            glm::ivec3 to(
+                std::min(end.x, (cx + 1) * CHUNK_W - 1),
+                end.y,
+                std::min(end.z, (cz + 1) * CHUNK_D - 1)
+            );
+            edits.clear();
+            for (int y = from.y; y <= to.y; y++) {
+                for (int z = from.z; z <= to.z; z++) {
+                    for (int x = from.x; x <= to.x; x++) {
+                        edits.push_back(BlockEdit {
+                            {x, y, z},
+                            static_cast<blockid_t>(id),
+                            int2blockstate(state)});
+                    }
+                }
+            }
+            blocks->setBlocks(edits, !noupdate);
+        }
+    }
+    return 0;
+}
+
+static int l_set_many(lua::State* L) {
+    if (!lua::istable(L, 1)) {
+        throw std::runtime_error("expected array of integers");
+    }
+    bool noupdate = lua::toboolean(L, 2);
+    size_t len = lua::objlen(L, 1);
+    if (len % 5) {
+        throw std::runtime_error("array length must be a multiple of 5");
+    }
+    std::vector<BlockEdit> edits;
+    edits.reserve(len / 5);
+    for (size_t i = 0; i < len; i += 5) {
+        lua::Integer values[5];
+        for (int j = 0; j < 5; j++) {
+            lua::rawgeti(L, i + j + 1, 1);
+            values[j] = lua::tointeger(L, -1);
+            lua::pop(L);
+        }
+        if (static_cast<size_t>(values[3]) >= indices->blocks.count()) {
+            continue;
+        }
+        edits.push_back(BlockEdit {
+            glm::ivec3(values[0], values[1], values[2]),
+            static_cast<blockid_t>(values[3]),
+            int2blockstate(values[4])});
+    }
+    blocks->setBlocks(edits, !noupdate);
+    return 0;
+}
+
 static int l_get(lua::State* L) {
     auto x = lua::tointeger(L, 1);
     auto y = lua::tointeger(L, 2);
@@ -349,6 +437,17 @@ static int l_destruct(lua::State* L) {
     return 0;
 }
 
+static int l_schedule_update(lua::State* L) {
+    auto x = lua::tointeger(L, 1);
+    auto y = lua::tointeger(L, 2);
+    auto z = lua::tointeger(L, 3);
+    auto delay = lua::gettop(L) >= 4 ? lua::tointeger(L, 4) : 1;
+    blocks->scheduleUpdate(
+        x, y, z, static_cast<uint>(std::max<lua::Integer>(1, delay))
+    );
+    return 0;
+}
+
 static int l_raycast(lua::State* L) {
     auto start = lua::tovec<3>(L, 1);
     auto dir = lua::tovec<3>(L, 2);
@@ -428,6 +527,8 @@ const luaL_Reg blocklib[] = {
     {"is_solid_at", lua::wrap<l_is_solid_at>},
     {"is_replaceable_at", lua::wrap<l_is_replaceable_at>},
     {"set", lua::wrap<l_set>},
+    {"fill", lua::wrap<l_fill>},
+    {"set_many", lua::wrap<l_set_many>},
     {"get", lua::wrap<l_get>},
     {"get_X", lua::wrap<l_get_x>},
     {"get_Y", lua::wrap<l_get_y>},
@@ -449,6 +550,7 @@ const luaL_Reg blocklib[] = {
     {"get_picking_item", lua::wrap<l_get_picking_item>},
     {"place", lua::wrap<l_place>},
     {"destruct", lua::wrap<l_destruct>},
+    {"schedule_update", lua::wrap<l_schedule_update>},
     {"raycast", lua::wrap<l_raycast>},
     {"compose_state", lua::wrap<l_compose_state>},
     {"decompose_state", lua::wrap<l_decompose_state>},
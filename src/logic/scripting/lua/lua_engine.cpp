@@ -30,6 +30,7 @@ static void remove_lib_funcs(
 
 static void create_libs(lua::State* L) {
     openlib(L, "audio", audiolib);
+    openlib(L, "bench", benchlib);
     openlib(L, "block", blocklib);
     openlib(L, "console", consolelib);
     openlib(L, "core", corelib);
@@ -114,6 +115,30 @@ bool lua::emit_event(
     return result;
 }
 
+lua::EventHandle lua::create_event_handle(
+    lua::State* L, const std::string& name, const char* emitter
+) {
+    EventHandle handle;
+    getglobal(L, "events");
+    if (!getfield(L, emitter)) {
+        pop(L);
+        throw std::runtime_error(
+            "events." + std::string(emitter) + " not found"
+        );
+    }
+    handle.emitter = luaL_ref(L, LUA_REGISTRYINDEX);
+    pop(L);
+    pushstring(L, name);
+    handle.name = luaL_ref(L, LUA_REGISTRYINDEX);
+    return handle;
+}
+
+void lua::release_event_handle(lua::State* L, EventHandle& handle) {
+    luaL_unref(L, LUA_REGISTRYINDEX, handle.name);
+    luaL_unref(L, LUA_REGISTRYINDEX, handle.emitter);
+    handle = {};
+}
+
 lua::State* lua::get_main_thread() {
     return main_thread;
 }
@@ -18,6 +18,38 @@ namespace lua {
         const std::string& name,
         std::function<int(lua::State*)> args = [](auto*) { return 0; }
     );
+
+    /// @brief Interned event name and resolved events emitter function,
+    /// both stored as registry references
+    struct EventHandle {
+        int name = LUA_NOREF;
+        int emitter = LUA_NOREF;
+    };
+
+    /// @param emitter name of the events table function used to emit
+    EventHandle create_event_handle(
+        lua::State*, const std::string& name, const char* emitter = "emit"
+    );
+    void release_event_handle(lua::State*, EventHandle& handle);
+
+    /// @brief Emit event by handle: no lookups and allocations
+    /// @param args function pushing event arguments, returns their number
+    template <typename Func>
+    bool emit_event(lua::State* L, const EventHandle& handle, const Func& args) {
+        int top = gettop(L);
+        rawgeti(L, handle.emitter, LUA_REGISTRYINDEX);
+        rawgeti(L, handle.name, LUA_REGISTRYINDEX);
+        bool result = false;
+        if (call_nothrow(L, args(L) + 1)) {
+            result = toboolean(L, -1);
+        }
+        settop(L, top);
+        return result;
+    }
+
+    inline bool emit_event(lua::State* L, const EventHandle& handle) {
+        return emit_event(L, handle, [](auto*) { return 0; });
+    }
     lua::State* get_main_thread();
 }
 
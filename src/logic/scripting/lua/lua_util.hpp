@@ -48,6 +48,12 @@ namespace lua {
     inline int gettop(lua::State* L) {
         return lua_gettop(L);
     }
+    inline void settop(lua::State* L, int idx) {
+        lua_settop(L, idx);
+    }
+    inline bool checkstack(lua::State* L, int n) {
+        return lua_checkstack(L, n);
+    }
     inline size_t objlen(lua::State* L, int idx) {
         return lua_objlen(L, idx);
     }
@@ -36,6 +36,44 @@ const ContentIndices* scripting::indices = nullptr;
 BlocksController* scripting::blocks = nullptr;
 LevelController* scripting::controller = nullptr;
 
+/// @brief Block events resolved on world load
+struct BlockEvents {
+    lua::EventHandle update;
+    /// @brief Random updates of many blocks emitted at once
+    lua::EventHandle randupdates;
+    lua::EventHandle placed;
+    lua::EventHandle broken;
+    lua::EventHandle interact;
+    lua::EventHandle blockstick;
+};
+
+struct ItemEvents {
+    lua::EventHandle use;
+    lua::EventHandle useon;
+    lua::EventHandle blockbreakby;
+};
+
+struct PackEvents {
+    lua::EventHandle worldopen;
+    lua::EventHandle worldtick;
+    lua::EventHandle worldsave;
+    lua::EventHandle worldquit;
+};
+
+/// @brief Indexed by block id
+static std::vector<BlockEvents> block_events;
+/// @brief Indexed by item id
+static std::vector<ItemEvents> item_events;
+/// @brief In order of engine content packs
+static std::vector<PackEvents> pack_events;
+/// @brief Packs subscribed to on_block_placed
+static std::vector<lua::EventHandle> blockplaced_events;
+/// @brief Packs subscribed to on_block_broken
+static std::vector<lua::EventHandle> blockbroken_events;
+
+/// @brief Max number of blocks passed to Lua in a single random updates call
+static constexpr size_t RANDOM_UPDATES_BATCH = 64;
+
 static void load_script(const fs::path& name, bool throwable) {
     auto paths = scripting::engine->getPaths();
     fs::path file = paths->getResources() / fs::path("scripts") / name;
@@ -144,6 +182,83 @@ void scripting::process_post_runnables() {
     }
 }
 
+static void create_event_handles(lua::State* L) {
+    for (const auto def : indices->blocks.getIterable()) {
+        const std::string& name = def->name;
+        block_events.push_back(BlockEvents {
+            lua::create_event_handle(L, name + ".update"),
+            lua::create_event_handle(
+                L, name + ".randupdate", "emit_positions"
+            ),
+            lua::create_event_handle(L, name + ".placed"),
+            lua::create_event_handle(L, name + ".broken"),
+            lua::create_event_handle(L, name + ".interact"),
+            lua::create_event_handle(L, name + ".blockstick")});
+    }
+    for (const auto def : indices->items.getIterable()) {
+        const std::string& name = def->name;
+        item_events.push_back(ItemEvents {
+            lua::create_event_handle(L, name + ".use"),
+            lua::create_event_handle(L, name + ".useon"),
+            lua::create_event_handle(L, name + ".blockbreakby")});
+    }
+    for (auto& pack : scripting::engine->getContentPacks()) {
+        pack_events.push_back(PackEvents {
+            lua::create_event_handle(L, pack.id + ".worldopen"),
+            lua::create_event_handle(L, pack.id + ".worldtick"),
+            lua::create_event_handle(L, pack.id + ".worldsave"),
+            lua::create_event_handle(L, pack.id + ".worldquit")});
+    }
+    for (auto& [packid, pack] : content->getPacks()) {
+        if (pack->worldfuncsset.onblockplaced) {
+            blockplaced_events.push_back(
+                lua::create_event_handle(L, packid + ".blockplaced")
+            );
+        }
+        if (pack->worldfuncsset.onblockbroken) {
+            blockbroken_events.push_back(
+                lua::create_event_handle(L, packid + ".blockbroken")
+            );
+        }
+    }
+}
+
+static void release_event_handles(lua::State* L) {
+    auto release = [L](lua::EventHandle& handle) {
+        lua::release_event_handle(L, handle);
+    };
+    for (auto& events : block_events) {
+        release(events.update);
+        release(events.randupdates);
+        release(events.placed);
+        release(events.broken);
+        release(events.interact);
+        release(events.blockstick);
+    }
+    for (auto& events : item_events) {
+        release(events.use);
+        release(events.useon);
+        release(events.blockbreakby);
+    }
+    for (auto& events : pack_events) {
+        release(events.worldopen);
+        release(events.worldtick);
+        release(events.worldsave);
+        release(events.worldquit);
+    }
+    for (auto& handle : blockplaced_events) {
+        release(handle);
+    }
+    for (auto& handle : blockbroken_events) {
+        release(handle);
+    }
+    block_events.clear();
+    item_events.clear();
+    pack_events.clear();
+    blockplaced_events.clear();
+    blockbroken_events.clear();
+}
+
 void scripting::on_world_load(LevelController* controller) {
     scripting::level = controller->getLevel();
     scripting::content = level->content;
@@ -153,30 +268,32 @@ void scripting::on_world_load(LevelController* controller) {
     load_script("world.lua", false);
 
     auto L = lua::get_main_thread();
-    for (auto& pack : scripting::engine->getContentPacks()) {
-        lua::emit_event(L, pack.id + ".worldopen");
+    create_event_handles(L);
+    for (const auto& events : pack_events) {
+        lua::emit_event(L, events.worldopen);
     }
 }
 
 void scripting::on_world_tick() {
     auto L = lua::get_main_thread();
-    for (auto& pack : scripting::engine->getContentPacks()) {
-        lua::emit_event(L, pack.id + ".worldtick");
+    for (const auto& events : pack_events) {
+        lua::emit_event(L, events.worldtick);
     }
 }
 
 void scripting::on_world_save() {
     auto L = lua::get_main_thread();
-    for (auto& pack : scripting::engine->getContentPacks()) {
-        lua::emit_event(L, pack.id + ".worldsave");
+    for (const auto& events : pack_events) {
+        lua::emit_event(L, events.worldsave);
     }
 }
 
 void scripting::on_world_quit() {
     auto L = lua::get_main_thread();
-    for (auto& pack : scripting::engine->getContentPacks()) {
-        lua::emit_event(L, pack.id + ".worldquit");
+    for (const auto& events : pack_events) {
+        lua::emit_event(L, events.worldquit);
     }
+    release_event_handles(L);
 
     lua::getglobal(L, "pack");
     for (auto& pack : scripting::engine->getContentPacks()) {
@@ -197,31 +314,46 @@ void scripting::on_world_quit() {
 }
 
 void scripting::on_blocks_tick(const Block& block, int tps) {
-    std::string name = block.name + ".blockstick";
-    lua::emit_event(lua::get_main_thread(), name, [tps](auto L) {
-        return lua::pushinteger(L, tps);
-    });
+    lua::emit_event(
+        lua::get_main_thread(),
+        block_events[block.rt.id].blockstick,
+        [tps](auto L) { return lua::pushinteger(L, tps); }
+    );
 }
 
 void scripting::update_block(const Block& block, int x, int y, int z) {
-    std::string name = block.name + ".update";
-    lua::emit_event(lua::get_main_thread(), name, [x, y, z](auto L) {
-        return lua::pushivec3_stack(L, x, y, z);
-    });
+    lua::emit_event(
+        lua::get_main_thread(),
+        block_events[block.rt.id].update,
+        [x, y, z](auto L) { return lua::pushivec3_stack(L, x, y, z); }
+    );
 }
 
-void scripting::random_update_block(const Block& block, int x, int y, int z) {
-    std::string name = block.name + ".randupdate";
-    lua::emit_event(lua::get_main_thread(), name, [x, y, z](auto L) {
-        return lua::pushivec3_stack(L, x, y, z);
-    });
+void scripting::random_update_blocks(
+    const Block& block, const glm::ivec3* positions, size_t count
+) {
+    auto L = lua::get_main_thread();
+    const auto& handle = block_events[block.rt.id].randupdates;
+    for (size_t offset = 0; offset < count; offset += RANDOM_UPDATES_BATCH) {
+        size_t size = std::min(count - offset, RANDOM_UPDATES_BATCH);
+        if (!lua::checkstack(L, size * 3 + 3)) {
+            throw std::runtime_error("lua stack overflow");
+        }
+        lua::emit_event(L, handle, [positions, offset, size](auto L) {
+            for (size_t i = 0; i < size; i++) {
+                lua::pushivec3_stack(L, positions[offset + i]);
+            }
+            return static_cast<int>(size * 3);
+        });
+    }
 }
 
 void scripting::on_block_placed(
     Player* player, const Block& block, int x, int y, int z
 ) {
-    std::string name = block.name + ".placed";
-    lua::emit_event(lua::get_main_thread(), name, [x, y, z, player](auto L) {
+    auto L = lua::get_main_thread();
+    const auto& handle = block_events[block.rt.id].placed;
+    lua::emit_event(L, handle, [x, y, z, player](auto L) {
         lua::pushivec3_stack(L, x, y, z);
         lua::pushinteger(L, player ? player->getId() : -1);
         return 4;
@@ -232,31 +364,22 @@ void scripting::on_block_placed(
         lua::pushinteger(L, player ? player->getId() : -1);
         return 5;
     };
-    for (auto& [packid, pack] : content->getPacks()) {
-        if (pack->worldfuncsset.onblockplaced) {
-            lua::emit_event(
-                lua::get_main_thread(),
-                packid + ".blockplaced",
-                world_event_args
-            );
-        }
+    for (const auto& handle : blockplaced_events) {
+        lua::emit_event(L, handle, world_event_args);
     }
 }
 
 void scripting::on_block_broken(
     Player* player, const Block& block, int x, int y, int z
 ) {
+    auto L = lua::get_main_thread();
     if (block.rt.funcsset.onbroken) {
-        std::string name = block.name + ".broken";
-        lua::emit_event(
-            lua::get_main_thread(),
-            name,
-            [x, y, z, player](auto L) {
-                lua::pushivec3_stack(L, x, y, z);
-                lua::pushinteger(L, player ? player->getId() : -1);
-                return 4;
-            }
-        );
+        const auto& handle = block_events[block.rt.id].broken;
+        lua::emit_event(L, handle, [x, y, z, player](auto L) {
+            lua::pushivec3_stack(L, x, y, z);
+            lua::pushinteger(L, player ? player->getId() : -1);
+            return 4;
+        });
     }
     auto world_event_args = [&](lua::State* L) {
         lua::pushinteger(L, block.rt.id);
@@ -264,33 +387,29 @@ void scripting::on_block_broken(
         lua::pushinteger(L, player ? player->getId() : -1);
         return 5;
     };
-    for (auto& [packid, pack] : content->getPacks()) {
-        if (pack->worldfuncsset.onblockbroken) {
-            lua::emit_event(
-                lua::get_main_thread(),
-                packid + ".blockbroken",
-                world_event_args
-            );
-        }
+    for (const auto& handle : blockbroken_events) {
+        lua::emit_event(L, handle, world_event_args);
     }
 }
 
 bool scripting::on_block_interact(
     Player* player, const Block& block, glm::ivec3 pos
 ) {
-    std::string name = block.name + ".interact";
-    return lua::emit_event(lua::get_main_thread(), name, [pos, player](auto L) {
-        lua::pushivec3_stack(L, pos.x, pos.y, pos.z);
-        lua::pushinteger(L, player->getId());
-        return 4;
-    });
+    return lua::emit_event(
+        lua::get_main_thread(),
+        block_events[block.rt.id].interact,
+        [pos, player](auto L) {
+            lua::pushivec3_stack(L, pos.x, pos.y, pos.z);
+            lua::pushinteger(L, player->getId());
+            return 4;
+        }
+    );
 }
 
 bool scripting::on_item_use(Player* player, const ItemDef& item) {
-    std::string name = item.name + ".use";
     return lua::emit_event(
         lua::get_main_thread(),
-        name,
+        item_events[item.rt.id].use,
         [player](lua::State* L) { return lua::pushinteger(L, player->getId()); }
     );
 }
@@ -298,10 +417,9 @@ bool scripting::on_item_use(Player* player, const ItemDef& item) {
 bool scripting::on_item_use_on_block(
     Player* player, const ItemDef& item, glm::ivec3 ipos, glm::ivec3 normal
 ) {
-    std::string name = item.name + ".useon";
     return lua::emit_event(
         lua::get_main_thread(),
-        name,
+        item_events[item.rt.id].useon,
         [ipos, normal, player](auto L) {
             lua::pushivec3_stack(L, ipos.x, ipos.y, ipos.z);
             lua::pushinteger(L, player->getId());
@@ -314,10 +432,9 @@ bool scripting::on_item_use_on_block(
 bool scripting::on_item_break_block(
     Player* player, const ItemDef& item, int x, int y, int z
 ) {
-    std::string name = item.name + ".blockbreakby";
     return lua::emit_event(
         lua::get_main_thread(),
-        name,
+        item_events[item.rt.id].blockbreakby,
         [x, y, z, player](auto L) {
             lua::pushivec3_stack(L, x, y, z);
             lua::pushinteger(L, player->getId());
@@ -63,7 +63,10 @@ namespace scripting {
     void on_world_quit();
     void on_blocks_tick(const Block& block, int tps);
     void update_block(const Block& block, int x, int y, int z);
-    void random_update_block(const Block& block, int x, int y, int z);
+    /// @brief Random update of many blocks of the same type in a few calls
+    void random_update_blocks(
+        const Block& block, const glm::ivec3* positions, size_t count
+    );
     void on_block_placed(
         Player* player, const Block& block, int x, int y, int z
     );
@@ -19,6 +19,7 @@
 #include "rigging.hpp"
 #include <physics/Hitbox.hpp>
 #include <physics/PhysicsSolver.hpp>
+#include <util/JobSystem.hpp>
 #include <world/Level.hpp>
 
 static debug::Logger logger("entities");
@@ -28,6 +29,11 @@ static inline std::string COMP_RIGIDBODY = "rigidbody";
 static inline std::string COMP_SKELETON = "skeleton";
 static inline std::string SAVED_DATA_VARNAME = "SAVED_DATA";
 
+/// @brief Entities grid cell size, chunk-sized
+static constexpr float GRID_CELL_SIZE = 16.0f;
+/// @brief Number of bodies stepped by a single physics job
+static constexpr size_t PHYSICS_BATCH_SIZE = 32;
+
 void Transform::refresh() {
     combined = glm::mat4(1.0f);
     combined = glm::translate(combined, pos);
@@ -60,7 +66,10 @@ void Entity::setRig(const rigging::SkeletonConfig* rigConfig) {
 }
 
 Entities::Entities(Level* level)
-    : level(level), sensorsTickClock(20, 3), updateTickClock(20, 3) {
+    : level(level),
+      sensorsTickClock(20, 3),
+      updateTickClock(20, 3),
+      grid(GRID_CELL_SIZE) {
 }
 
 template <void (*callback)(const Entity&, size_t, entityid_t)>
@@ -139,6 +148,7 @@ entityid_t Entities::spawn(
     auto entity = registry.create();
     entities[id] = entity;
     uids[entity] = id;
+    gridModified = true;
 
     registry.emplace<EntityId>(entity, static_cast<entityid_t>(id), def);
     const auto& tsf = registry.emplace<Transform>(
@@ -244,17 +254,20 @@ void Entities::loadEntity(const dynamic::Map_sptr& map, Entity entity) {
 std::optional<Entities::RaycastResult> Entities::rayCast(
     glm::vec3 start, glm::vec3 dir, float maxDistance, entityid_t ignore
 ) {
+    updateGrid();
     Ray ray(start, dir);
-    auto view = registry.view<EntityId, Transform, Rigidbody>();
 
     entityid_t foundUID = 0;
     glm::ivec3 foundNormal;
 
-    for (auto [entity, eid, transform, body] : view.each()) {
+    AABB bounds(start, start);
+    bounds.addPoint(start + dir * maxDistance);
+    grid.query(bounds, [&](entt::entity entity) {
+        const auto& eid = registry.get<EntityId>(entity);
         if (eid.uid == ignore) {
-            continue;
+            return;
         }
-        auto& hitbox = body.hitbox;
+        auto& hitbox = registry.get<Rigidbody>(entity).hitbox;
         glm::ivec3 normal;
         double distance;
         if (ray.intersectAABB(
@@ -264,7 +277,7 @@ std::optional<Entities::RaycastResult> Entities::rayCast(
             foundNormal = normal;
             maxDistance = static_cast<float>(distance);
         }
-    }
+    });
     if (foundUID) {
         return Entities::RaycastResult {foundUID, foundNormal, maxDistance};
     } else {
@@ -370,6 +383,7 @@ void Entities::clean() {
             uids.erase(it->second);
             registry.destroy(it->second);
             it = entities.erase(it);
+            gridModified = true;
         }
     }
 }
@@ -426,34 +440,115 @@ void Entities::preparePhysics(float delta) {
     }
 }
 
+namespace {
+    struct BodyStep {
+        entityid_t uid;
+        Transform* transform;
+        Hitbox* hitbox;
+        glm::vec3 prevVel;
+        bool prevGrounded;
+        bool grounded;
+        float impact;
+    };
+}
+
 void Entities::updatePhysics(float delta) {
     preparePhysics(delta);
 
     auto view = registry.view<EntityId, Transform, Rigidbody>();
     auto physics = level->physics.get();
+    auto chunks = level->chunks.get();
+
+    std::vector<BodyStep> bodies;
     for (auto [entity, eid, transform, rigidbody] : view.each()) {
         if (!rigidbody.enabled || rigidbody.hitbox.type == BodyType::STATIC) {
             continue;
         }
         auto& hitbox = rigidbody.hitbox;
-        auto prevVel = hitbox.velocity;
-        bool grounded = hitbox.grounded;
-
-        float vel = glm::length(prevVel);
-        int substeps = static_cast<int>(delta * vel * 20);
-        substeps = std::min(100, std::max(2, substeps));
-        physics->step(level->chunks.get(), &hitbox, delta, substeps, eid.uid);
-        hitbox.linearDamping = hitbox.grounded * 24;
-        transform.setPos(hitbox.position);
-        if (hitbox.grounded && !grounded) {
-            scripting::on_entity_grounded(
-                *get(eid.uid), glm::length(prevVel - hitbox.velocity)
-            );
+        bodies.push_back(BodyStep {
+            eid.uid,
+            &transform,
+            &hitbox,
+            hitbox.velocity,
+            hitbox.grounded,
+            false,
+            0.0f});
+    }
+    size_t batches =
+        (bodies.size() + PHYSICS_BATCH_SIZE - 1) / PHYSICS_BATCH_SIZE;
+    // every batch has own events buffer, so events order does not depend
+    // on threads scheduling
+    std::vector<std::vector<SensorEvent>> events(batches);
+    auto stepBatch = [&](size_t batch) {
+        size_t end = std::min(bodies.size(), (batch + 1) * PHYSICS_BATCH_SIZE);
+        for (size_t i = batch * PHYSICS_BATCH_SIZE; i < end; i++) {
+            auto& body = bodies[i];
+            auto& hitbox = *body.hitbox;
+
+            float vel = glm::length(body.prevVel);
+            // swept collision does not let fast bodies pass through blocks,
+            // substeps only refine gravity and damping integration
+            int substeps = static_cast<int>(delta * vel * 2);
+            substeps = std::min(8, std::max(2, substeps));
+            physics->step(chunks, &hitbox, delta, substeps);
+            hitbox.linearDamping = hitbox.grounded * 24;
+            body.transform->setPos(hitbox.position);
+            body.grounded = hitbox.grounded;
+            body.impact = glm::length(body.prevVel - hitbox.velocity);
+            physics->findSensors(hitbox, body.uid, events[batch]);
+        }
+    };
+    auto& jobSystem = util::JobSystem::getInstance();
+    std::vector<util::JobHandle> jobs;
+    for (size_t batch = 1; batch < batches; batch++) {
+        jobs.push_back(jobSystem.submit(
+            [&stepBatch, batch]() { stepBatch(batch); },
+            util::JobPriority::high
+        ));
+    }
+    // main thread steps the first batch while waiting for others
+    if (batches) {
+        stepBatch(0);
+    }
+    // batches are high priority jobs, so waiting thread helps with
+    // other high priority jobs only and is never blocked by background
+    // jobs like chunks generation or regions writing
+    for (const auto& job : jobs) {
+        jobSystem.wait(job);
+    }
+
+    // scripting callbacks are called on the main thread in bodies order
+    for (const auto& batchEvents : events) {
+        for (const auto& event : batchEvents) {
+            PhysicsSolver::trigger(event);
         }
-        if (!hitbox.grounded && grounded) {
-            scripting::on_entity_fall(*get(eid.uid));
+    }
+    for (const auto& body : bodies) {
+        if (body.grounded && !body.prevGrounded) {
+            scripting::on_entity_grounded(*get(body.uid), body.impact);
         }
+        if (!body.grounded && body.prevGrounded) {
+            scripting::on_entity_fall(*get(body.uid));
+        }
+    }
+    gridModified = true;
+}
+
+void Entities::updateGrid() {
+    if (!gridModified) {
+        return;
+    }
+    grid.clear();
+    auto view = registry.view<Transform, Rigidbody>();
+    for (auto [entity, transform, body] : view.each()) {
+        const auto& hitbox = body.hitbox;
+        // transform position is used by the queries too
+        glm::vec3 halfsize = glm::max(
+            hitbox.halfsize, glm::abs(transform.pos - hitbox.position)
+        );
+        grid.insert(hitbox.position, halfsize, entity);
     }
+    gridModified = false;
 }
 
 void Entities::update(float delta) {
@@ -558,45 +653,52 @@ void Entities::render(
 }
 
 bool Entities::hasBlockingInside(AABB aabb) {
-    auto view = registry.view<EntityId, Rigidbody>();
-    for (auto [entity, eid, body] : view.each()) {
+    updateGrid();
+    bool blocking = false;
+    grid.query(aabb, [&](entt::entity entity) {
+        const auto& eid = registry.get<EntityId>(entity);
+        const auto& body = registry.get<Rigidbody>(entity);
         if (eid.def.blocking && aabb.intersect(body.hitbox.getAABB(), -0.05f)) {
-            return true;
+            blocking = true;
         }
-    }
-    return false;
+    });
+    return blocking;
 }
 
 std::vector<Entity> Entities::getAllInside(AABB aabb) {
+    updateGrid();
     std::vector<Entity> collected;
-    auto view = registry.view<Transform>();
-    for (auto [entity, transform] : view.each()) {
-        if (aabb.contains(transform.pos)) {
-            const auto& found = uids.find(entity);
-            if (found == uids.end()) {
-                continue;
-            }
-            if (auto wrapper = get(found->second)) {
-                collected.push_back(*wrapper);
-            }
+    grid.query(aabb, [&](entt::entity entity) {
+        if (!aabb.contains(registry.get<Transform>(entity).pos)) {
+            return;
         }
-    }
+        const auto& found = uids.find(entity);
+        if (found == uids.end()) {
+            return;
+        }
+        if (auto wrapper = get(found->second)) {
+            collected.push_back(*wrapper);
+        }
+    });
     return collected;
 }
 
 std::vector<Entity> Entities::getAllInRadius(glm::vec3 center, float radius) {
+    updateGrid();
     std::vector<Entity> collected;
-    auto view = registry.view<Transform>();
-    for (auto [entity, transform] : view.each()) {
-        if (glm::distance2(transform.pos, center) <= radius * radius) {
-            const auto& found = uids.find(entity);
-            if (found == uids.end()) {
-                continue;
-            }
-            if (auto wrapper = get(found->second)) {
-                collected.push_back(*wrapper);
-            }
+    AABB aabb(center - radius, center + radius);
+    grid.query(aabb, [&](entt::entity entity) {
+        const auto& transform = registry.get<Transform>(entity);
+        if (glm::distance2(transform.pos, center) > radius * radius) {
+            return;
         }
-    }
+        const auto& found = uids.find(entity);
+        if (found == uids.end()) {
+            return;
+        }
+        if (auto wrapper = get(found->second)) {
+            collected.push_back(*wrapper);
+        }
+    });
     return collected;
 }
@@ -8,6 +8,7 @@
 
 #include <data/dynamic.hpp>
 #include <physics/Hitbox.hpp>
+#include <physics/SpatialGrid.hpp>
 #include <typedefs.hpp>
 #include <util/Clock.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
@@ -173,7 +174,12 @@ class Entities {
     entityid_t nextID = 1;
     util::Clock sensorsTickClock;
     util::Clock updateTickClock;
+    /// @brief Broadphase index of entities hitboxes
+    SpatialGrid<entt::entity> grid;
+    bool gridModified = true;
 
+    /// @brief Rebuild the grid if entities were moved, spawned or removed
+    void updateGrid();
     void updateSensors(
         Rigidbody& body, const Transform& tsf, std::vector<Sensor*>& sensors
     );
@@ -189,6 +195,12 @@ public:
 
     void clean();
     void updatePhysics(float delta);
+
+    /// @brief Notify about entity transform or hitbox modified outside of
+    /// physics update, so it will be found by spatial queries
+    void markMoved() {
+        gridModified = true;
+    }
     void update(float delta);
 
     void renderDebug(
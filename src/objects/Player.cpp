@@ -175,6 +175,7 @@ void Player::teleport(glm::vec3 position) {
     this->position = position;
     if (auto hitbox = getHitbox()) {
         hitbox->position = position;
+        level->entities->markMoved();
     }
 }
 
@@ -11,22 +11,98 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/norm.hpp>
 
+/// @brief Collision tolerance
 const float E = 0.03f;
-const float MAX_FIX = 0.1f;
 
-PhysicsSolver::PhysicsSolver(glm::vec3 gravity) : gravity(gravity) {
+/// @brief Sensors grid cell size, chunk-sized
+const float SENSORS_CELL_SIZE = 16.0f;
+
+/// @brief Max distance from the body colliders are collected at once.
+/// Faster bodies collect colliders along the path, sweep by sweep
+const float MAX_COLLIDERS_REACH = 4.0f;
+
+/// @brief Max number of path sweeps per substep, so a body passes no
+/// more than MAX_SWEEPS * MAX_COLLIDERS_REACH / 2 blocks per substep
+const int MAX_SWEEPS = 64;
+
+static float max_component(const glm::vec3& vec) {
+    return std::max(vec.x, std::max(vec.y, vec.z));
+}
+
+PhysicsSolver::PhysicsSolver(glm::vec3 gravity)
+    : gravity(gravity), sensorsGrid(SENSORS_CELL_SIZE) {
+}
+
+static void get_sensor_bounds(
+    const Sensor& sensor, glm::vec3& center, glm::vec3& halfsize
+) {
+    switch (sensor.type) {
+        case SensorType::AABB:
+            center = sensor.calculated.aabb.center();
+            halfsize = sensor.calculated.aabb.size() * 0.5f;
+            break;
+        case SensorType::RADIUS:
+            center = glm::vec3(sensor.calculated.radial);
+            // w is the squared radius
+            halfsize = glm::vec3(glm::sqrt(sensor.calculated.radial.w));
+            break;
+    }
+}
+
+/// @brief Clip motion along the axis by colliders the box would hit
+/// @return true if motion was clipped
+static bool sweep_axis(
+    const std::vector<AABB>& colliders, const AABB& box, int axis, float& motion
+) {
+    if (motion == 0.0f) {
+        return false;
+    }
+    int a1 = (axis + 1) % 3;
+    int a2 = (axis + 2) % 3;
+    bool hit = false;
+    for (const auto& collider : colliders) {
+        // touching colliders do not block sliding along them
+        if (box.b[a1] <= collider.a[a1] + E || box.a[a1] >= collider.b[a1] - E ||
+            box.b[a2] <= collider.a[a2] + E || box.a[a2] >= collider.b[a2] - E) {
+            continue;
+        }
+        if (motion > 0.0f && collider.a[axis] >= box.b[axis] - E) {
+            float distance = glm::max(0.0f, collider.a[axis] - box.b[axis]);
+            if (distance < motion) {
+                motion = distance;
+                hit = true;
+            }
+        } else if (motion < 0.0f && collider.b[axis] <= box.a[axis] + E) {
+            float distance = glm::min(0.0f, collider.b[axis] - box.a[axis]);
+            if (distance > motion) {
+                motion = distance;
+                hit = true;
+            }
+        }
+    }
+    return hit;
+}
+
+/// @brief Check if there is a collider right under the box
+static bool is_supported(const std::vector<AABB>& colliders, const AABB& box) {
+    float motion = -E * 2;
+    return sweep_axis(colliders, box, 1, motion);
+}
+
+static void move_axis(glm::vec3& pos, AABB& box, int axis, float motion) {
+    pos[axis] += motion;
+    box.a[axis] += motion;
+    box.b[axis] += motion;
 }
 
 void PhysicsSolver::step(
     Chunks* chunks, 
     Hitbox* hitbox, 
     float delta, 
-    uint substeps, 
-    entityid_t entity
+    uint substeps
 ) {
     float dt = delta / static_cast<float>(substeps);
     float linearDamping = hitbox->linearDamping;
-    float s = 2.0f/BLOCK_AABB_GRID;
 
     const glm::vec3& half = hitbox->halfsize;
     glm::vec3& pos = hitbox->position;
@@ -35,218 +111,161 @@ void PhysicsSolver::step(
     
     bool prevGrounded = hitbox->grounded;
     hitbox->grounded = false;
+
+    bool collide = hitbox->type == BodyType::DYNAMIC;
+    float stepHeight = (prevGrounded && gravityScale > 0.0f) ? 0.5f : 0.0f;
+    // collected once for all cells the body may reach during the step
+    static thread_local std::vector<AABB> colliders;
+    colliders.clear();
+    bool collectOnce = false;
+    if (collide) {
+        glm::vec3 reach = glm::abs(vel) * delta +
+                          glm::abs(gravity * gravityScale) * delta * delta +
+                          stepHeight + 1.0f;
+        collectOnce = max_component(reach) <= MAX_COLLIDERS_REACH;
+        if (collectOnce) {
+            chunks->getColliders(
+                AABB(pos - half - reach, pos + half + reach), colliders
+            );
+        }
+    }
     for (uint i = 0; i < substeps; i++) {
-        float px = pos.x;
-        float py = pos.y;
-        float pz = pos.z;
-        
         vel += gravity * dt * gravityScale;
-        if (hitbox->type == BodyType::DYNAMIC) {
-            colisionCalc(chunks, hitbox, vel, pos, half, 
-                         (prevGrounded && gravityScale > 0.0f) ? 0.5f : 0.0f);
-        }
         vel.x *= glm::max(0.0f, 1.0f - dt * linearDamping);
         if (hitbox->verticalDamping) {
             vel.y *= glm::max(0.0f, 1.0f - dt * linearDamping);
         }
         vel.z *= glm::max(0.0f, 1.0f - dt * linearDamping);
 
-        pos += vel * dt + gravity * gravityScale * dt * dt * 0.5f;
-        if (hitbox->grounded && pos.y < py) {
-            pos.y = py;
-        }
-
-        if (hitbox->crouching && hitbox->grounded){
-            float y = (pos.y-half.y-E);
-            hitbox->grounded = false;
-            for (float x = (px-half.x+E); x <= (px+half.x-E); x+=s){
-                for (float z = (pos.z-half.z+E); z <= (pos.z+half.z-E); z+=s){
-                    if (chunks->isObstacleAt(x,y,z)){
-                        hitbox->grounded = true;
-                        break;
-                    }
-                }
-            }
-            if (!hitbox->grounded) {
-                pos.z = pz;
-            }
-            hitbox->grounded = false;
-            for (float x = (pos.x-half.x+E); x <= (pos.x+half.x-E); x+=s){
-                for (float z = (pz-half.z+E); z <= (pz+half.z-E); z+=s){
-                    if (chunks->isObstacleAt(x,y,z)){
-                        hitbox->grounded = true;
-                        break;
-                    }
-                }
-            }
-            if (!hitbox->grounded) {
-                pos.x = px;
-            }
-            hitbox->grounded = true;
+        glm::vec3 motion = vel * dt + gravity * gravityScale * dt * dt * 0.5f;
+        if (collectOnce) {
+            moveBody(colliders, hitbox, motion, stepHeight);
+        } else if (collide) {
+            sweepBody(chunks, hitbox, motion, stepHeight);
+        } else {
+            pos += motion;
         }
     }
-    AABB aabb;
-    aabb.a = hitbox->position - hitbox->halfsize;
-    aabb.b = hitbox->position + hitbox->halfsize;
-    for (size_t i = 0; i < sensors.size(); i++) {
-        auto& sensor = *sensors[i];
-        if (sensor.entity == entity) {
-            continue;
-        }
+}
 
-        bool triggered = false;
-        switch (sensor.type) {
-            case SensorType::AABB:
-                triggered = aabb.intersect(sensor.calculated.aabb);
-                break;
-            case SensorType::RADIUS:
-                triggered = glm::distance2(
-                    hitbox->position, glm::vec3(sensor.calculated.radial))
-                     < sensor.calculated.radial.w;
-                break;
-        }
-        if (triggered) {
-            if (sensor.prevEntered.find(entity) == sensor.prevEntered.end()) {
-                sensor.enterCallback(sensor.entity, sensor.index, entity);
-            }
-            sensor.nextEntered.insert(entity);
-        }
+void PhysicsSolver::sweepBody(
+    Chunks* chunks, Hitbox* hitbox, glm::vec3 motion, float stepHeight
+) {
+    static thread_local std::vector<AABB> colliders;
+
+    const float sweepLength = MAX_COLLIDERS_REACH * 0.5f;
+    float length = max_component(glm::abs(motion));
+    int sweeps = static_cast<int>(std::ceil(length / sweepLength));
+    if (sweeps > MAX_SWEEPS) {
+        motion *= MAX_SWEEPS * sweepLength / length;
+        sweeps = MAX_SWEEPS;
+    }
+    glm::vec3 sweep = motion / static_cast<float>(std::max(1, sweeps));
+    glm::vec3 reach = glm::abs(sweep) + stepHeight + 1.0f;
+    const glm::vec3& half = hitbox->halfsize;
+    for (int i = 0; i < sweeps; i++) {
+        const glm::vec3& pos = hitbox->position;
+        colliders.clear();
+        chunks->getColliders(
+            AABB(pos - half - reach, pos + half + reach), colliders
+        );
+        moveBody(colliders, hitbox, sweep, stepHeight);
     }
 }
 
-void PhysicsSolver::colisionCalc(
-    Chunks* chunks, 
-    Hitbox* hitbox, 
-    glm::vec3& vel, 
-    glm::vec3& pos, 
-    const glm::vec3 half,
+void PhysicsSolver::moveBody(
+    const std::vector<AABB>& colliders,
+    Hitbox* hitbox,
+    glm::vec3 motion,
     float stepHeight
 ) {
-    // step size (smaller - more accurate, but slower)
-    float s = 2.0f/BLOCK_AABB_GRID;
+    glm::vec3& pos = hitbox->position;
+    glm::vec3& vel = hitbox->velocity;
+    AABB box = hitbox->getAABB();
 
-    if (stepHeight > 0.0f) {
-        for (float x = (pos.x-half.x+E); x <= (pos.x+half.x-E); x+=s){
-            for (float z = (pos.z-half.z+E); z <= (pos.z+half.z-E); z+=s){
-                if (chunks->isObstacleAt(x, pos.y+half.y+stepHeight, z)) {
-                    stepHeight = 0.0f;
-                    break;
-                }
-            }
+    float falling = motion.y;
+    if (sweep_axis(colliders, box, 1, motion.y)) {
+        vel.y = 0.0f;
+        if (falling < 0.0f) {
+            hitbox->grounded = true;
         }
     }
+    move_axis(pos, box, 1, motion.y);
 
-    const AABB* aabb;
-    
-    if (vel.x < 0.0f){
-        for (float y = (pos.y-half.y+E+stepHeight); y <= (pos.y+half.y-E); y+=s){
-            for (float z = (pos.z-half.z+E); z <= (pos.z+half.z-E); z+=s){
-                float x = (pos.x-half.x-E);
-                if ((aabb = chunks->isObstacleAt(x,y,z))){
-                    vel.x = 0.0f;
-                    float newx = floor(x) + aabb->max().x + half.x + E;
-                    if (glm::abs(newx-pos.x) <= MAX_FIX) {
-                        pos.x = newx;
-                    }
-                    break;
-                }
+    for (int axis : {0, 2}) {
+        float wanted = motion[axis];
+        bool hit = sweep_axis(colliders, box, axis, motion[axis]);
+        if (hit && stepHeight > 0.0f && hitbox->grounded) {
+            // try to climb the obstacle: move up, forward and back down
+            AABB raised = box;
+            glm::vec3 raisedPos = pos;
+            float up = stepHeight;
+            sweep_axis(colliders, raised, 1, up);
+            move_axis(raisedPos, raised, 1, up);
+            float forward = wanted;
+            bool raisedHit = sweep_axis(colliders, raised, axis, forward);
+            if (glm::abs(forward) > glm::abs(motion[axis])) {
+                move_axis(raisedPos, raised, axis, forward);
+                float down = -up;
+                sweep_axis(colliders, raised, 1, down);
+                move_axis(raisedPos, raised, 1, down);
+                pos = raisedPos;
+                box = raised;
+                hit = raisedHit;
+                motion[axis] = 0.0f;
             }
         }
-    }
-    if (vel.x > 0.0f){
-        for (float y = (pos.y-half.y+E+stepHeight); y <= (pos.y+half.y-E); y+=s){
-            for (float z = (pos.z-half.z+E); z <= (pos.z+half.z-E); z+=s){
-                float x = (pos.x+half.x+E);
-                if ((aabb = chunks->isObstacleAt(x,y,z))){
-                    vel.x = 0.0f;
-                    float newx = floor(x) - half.x + aabb->min().x - E;
-                    if (glm::abs(newx-pos.x) <= MAX_FIX) {
-                        pos.x = newx;
-                    }
-                    break;
-                }
-            }
+        if (hit) {
+            vel[axis] = 0.0f;
         }
-    }
-
-    if (vel.z < 0.0f){
-        for (float y = (pos.y-half.y+E+stepHeight); y <= (pos.y+half.y-E); y+=s){
-            for (float x = (pos.x-half.x+E); x <= (pos.x+half.x-E); x+=s){
-                float z = (pos.z-half.z-E);
-                if ((aabb = chunks->isObstacleAt(x,y,z))){
-                    vel.z = 0.0f;
-                    float newz = floor(z) + aabb->max().z + half.z + E;
-                    if (glm::abs(newz-pos.z) <= MAX_FIX) { 
-                        pos.z = newz;
-                    }
-                    break;
-                }
-            }
+        AABB moved = box;
+        glm::vec3 movedPos = pos;
+        move_axis(movedPos, moved, axis, motion[axis]);
+        // crouching bodies do not fall from edges
+        if (hitbox->crouching && hitbox->grounded &&
+            !is_supported(colliders, moved)) {
+            continue;
         }
+        pos = movedPos;
+        box = moved;
     }
+}
 
-    if (vel.z > 0.0f){
-        for (float y = (pos.y-half.y+E+stepHeight); y <= (pos.y+half.y-E); y+=s){
-            for (float x = (pos.x-half.x+E); x <= (pos.x+half.x-E); x+=s){
-                float z = (pos.z+half.z+E);
-                if ((aabb = chunks->isObstacleAt(x,y,z))){
-                    vel.z = 0.0f;
-                    float newz = floor(z) - half.z + aabb->min().z - E;
-                    if (glm::abs(newz-pos.z) <= MAX_FIX) {
-                        pos.z = newz;
-                    }
-                    break;
-                }
-            }
+void PhysicsSolver::findSensors(
+    const Hitbox& hitbox,
+    entityid_t entity,
+    std::vector<SensorEvent>& events
+) const {
+    AABB aabb = hitbox.getAABB();
+    sensorsGrid.query(aabb, [&](Sensor* found) {
+        const auto& sensor = *found;
+        if (sensor.entity == entity) {
+            return;
         }
-    }
 
-    if (vel.y < 0.0f){
-        for (float x = (pos.x-half.x+E); x <= (pos.x+half.x-E); x+=s){
-            for (float z = (pos.z-half.z+E); z <= (pos.z+half.z-E); z+=s){
-                float y = (pos.y-half.y-E);
-                if ((aabb = chunks->isObstacleAt(x,y,z))){
-                    vel.y = 0.0f;
-                    float newy = floor(y) + aabb->max().y + half.y;
-                    if (glm::abs(newy-pos.y) <= MAX_FIX) {
-                        pos.y = newy;	
-                    }
-                    hitbox->grounded = true;
-                    break;
-                }
-            }
-        }
-    }
-    if (stepHeight > 0.0 && vel.y <= 0.0f){
-        for (float x = (pos.x-half.x+E); x <= (pos.x+half.x-E); x+=s){
-            for (float z = (pos.z-half.z+E); z <= (pos.z+half.z-E); z+=s){
-                float y = (pos.y-half.y+E);
-                if ((aabb = chunks->isObstacleAt(x,y,z))){
-                    vel.y = 0.0f;
-                    float newy = floor(y) + aabb->max().y + half.y;
-                    if (glm::abs(newy-pos.y) <= MAX_FIX+stepHeight) {
-                        pos.y = newy;	
-                    }
-                    break;
-                }
-            }
+        bool triggered = false;
+        switch (sensor.type) {
+            case SensorType::AABB:
+                triggered = aabb.intersect(sensor.calculated.aabb);
+                break;
+            case SensorType::RADIUS:
+                triggered = glm::distance2(
+                    hitbox.position, glm::vec3(sensor.calculated.radial))
+                     < sensor.calculated.radial.w;
+                break;
         }
-    }
-    if (vel.y > 0.0f){
-        for (float x = (pos.x-half.x+E); x <= (pos.x+half.x-E); x+=s){
-            for (float z = (pos.z-half.z+E); z <= (pos.z+half.z-E); z+=s){
-                float y = (pos.y+half.y+E);
-                if ((aabb = chunks->isObstacleAt(x,y,z))){
-                    vel.y = 0.0f;
-                    float newy = floor(y) - half.y + aabb->min().y - E;
-                    if (glm::abs(newy-pos.y) <= MAX_FIX) {
-                        pos.y = newy;
-                    }
-                    break;
-                }
-            }
+        if (triggered) {
+            events.push_back(SensorEvent {found, entity});
         }
+    });
+}
+
+void PhysicsSolver::trigger(const SensorEvent& event) {
+    auto& sensor = *event.sensor;
+    if (sensor.prevEntered.find(event.entity) == sensor.prevEntered.end()) {
+        sensor.enterCallback(sensor.entity, sensor.index, event.entity);
     }
+    sensor.nextEntered.insert(event.entity);
 }
 
 bool PhysicsSolver::isBlockInside(int x, int y, int z, Hitbox* hitbox) {
@@ -275,6 +294,24 @@ bool PhysicsSolver::isBlockInside(int x, int y, int z, Block* def, blockstate st
     return false;
 }
 
+void PhysicsSolver::setSensors(std::vector<Sensor*> sensors) {
+    this->sensors = std::move(sensors);
+    sensorsGrid.clear();
+    glm::vec3 center, halfsize;
+    for (auto sensor : this->sensors) {
+        get_sensor_bounds(*sensor, center, halfsize);
+        sensorsGrid.insert(center, halfsize, sensor);
+    }
+}
+
 void PhysicsSolver::removeSensor(Sensor* sensor) {
-    sensors.erase(std::remove(sensors.begin(), sensors.end(), sensor), sensors.end());
+    auto found = std::find(sensors.begin(), sensors.end(), sensor);
+    if (found == sensors.end()) {
+        return;
+    }
+    sensors.erase(found);
+    // sensor bounds are not updated until the next setSensors call
+    glm::vec3 center, halfsize;
+    get_sensor_bounds(*sensor, center, halfsize);
+    sensorsGrid.remove(center, sensor);
 }
@@ -2,6 +2,7 @@
 #define PHYSICS_PHYSICSSOLVER_HPP_
 
 #include "Hitbox.hpp"
+#include "SpatialGrid.hpp"
 
 #include <typedefs.hpp>
 #include <voxels/voxel.hpp>
@@ -13,32 +14,54 @@ class Block;
 class Chunks;
 struct Sensor;
 
+/// @brief Entity found inside of a sensor
+struct SensorEvent {
+    Sensor* sensor;
+    entityid_t entity;
+};
+
 class PhysicsSolver {
     glm::vec3 gravity;
     std::vector<Sensor*> sensors;
+    SpatialGrid<Sensor*> sensorsGrid;
 public:
     PhysicsSolver(glm::vec3 gravity);
-    void step(
-        Chunks* chunks,
-        Hitbox* hitbox,
-        float delta,
-        uint substeps,
-        entityid_t entity
-    );
-    void colisionCalc(
-        Chunks* chunks,
+
+    /// @brief Move the hitbox resolving collisions with blocks.
+    /// May be called from multiple threads for different hitboxes while
+    /// chunks are not modified
+    void step(Chunks* chunks, Hitbox* hitbox, float delta, uint substeps);
+
+    /// @brief Find sensors the entity hitbox is inside of (thread-safe)
+    void findSensors(
+        const Hitbox& hitbox,
+        entityid_t entity,
+        std::vector<SensorEvent>& events
+    ) const;
+
+    /// @brief Mark entity entered the sensor, call enter callback if it
+    /// was not inside on the previous sensors tick (main thread only)
+    static void trigger(const SensorEvent& event);
+
+    /// @brief Move the body resolving collisions per axis (Y, X, Z)
+    /// @param colliders world-space obstacles around the body
+    /// @param motion the body displacement
+    /// @param stepHeight max height of an obstacle to climb
+    void moveBody(
+        const std::vector<AABB>& colliders,
         Hitbox* hitbox,
-        glm::vec3& vel,
-        glm::vec3& pos,
-        const glm::vec3 half,
+        glm::vec3 motion,
         float stepHeight
     );
+    /// @brief Move body too fast to collect colliders once per step,
+    /// collecting them along the path
+    void sweepBody(
+        Chunks* chunks, Hitbox* hitbox, glm::vec3 motion, float stepHeight
+    );
     bool isBlockInside(int x, int y, int z, Hitbox* hitbox);
     bool isBlockInside(int x, int y, int z, Block* def, blockstate state, Hitbox* hitbox);
 
-    void setSensors(std::vector<Sensor*> sensors) {
-        this->sensors = std::move(sensors);
-    }
+    void setSensors(std::vector<Sensor*> sensors);
 
     void removeSensor(Sensor* sensor);
 };
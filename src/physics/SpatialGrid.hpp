@@ -0,0 +1,104 @@
+#ifndef PHYSICS_SPATIAL_GRID_HPP_
+#define PHYSICS_SPATIAL_GRID_HPP_
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include <maths/aabb.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+/// @brief Loose uniform grid used as broadphase for entities and sensors.
+/// Every value is stored once, in the cell containing its center; queries
+/// are expanded by the largest inserted half-size, so callers must check
+/// exact bounds of the found values
+template <typename T>
+class SpatialGrid {
+    float cellSize;
+    std::unordered_map<glm::ivec3, std::vector<T>> cells;
+    glm::vec3 maxHalfsize {};
+
+    glm::ivec3 cellOf(const glm::vec3& pos) const {
+        return glm::ivec3(glm::floor(pos / cellSize));
+    }
+public:
+    SpatialGrid(float cellSize) : cellSize(cellSize) {
+    }
+
+    /// @brief Remove all values. Cells left empty since the previous
+    /// clear are freed, others keep allocated memory
+    void clear() {
+        for (auto it = cells.begin(); it != cells.end();) {
+            if (it->second.empty()) {
+                it = cells.erase(it);
+            } else {
+                it->second.clear();
+                ++it;
+            }
+        }
+        maxHalfsize = {};
+    }
+
+    void insert(const glm::vec3& center, const glm::vec3& halfsize, T value) {
+        cells[cellOf(center)].push_back(std::move(value));
+        maxHalfsize = glm::max(maxHalfsize, glm::abs(halfsize));
+    }
+
+    /// @param center center the value was inserted with
+    void remove(const glm::vec3& center, const T& value) {
+        auto found = cells.find(cellOf(center));
+        if (found == cells.end()) {
+            return;
+        }
+        auto& values = found->second;
+        auto it = std::find(values.begin(), values.end(), value);
+        if (it != values.end()) {
+            *it = std::move(values.back());
+            values.pop_back();
+        }
+    }
+
+    /// @brief Call func for every value which bounds may intersect the box
+    template <typename Func>
+    void query(const AABB& aabb, const Func& func) const {
+        if (cells.empty()) {
+            return;
+        }
+        glm::dvec3 start =
+            glm::floor(glm::dvec3(aabb.min() - maxHalfsize) / double(cellSize));
+        glm::dvec3 end =
+            glm::floor(glm::dvec3(aabb.max() + maxHalfsize) / double(cellSize));
+        glm::dvec3 extent = end - start + 1.0;
+        // large boxes (long rays) visit existing cells instead
+        if (extent.x * extent.y * extent.z > double(cells.size())) {
+            for (const auto& [pos, values] : cells) {
+                if (pos.x < start.x || pos.y < start.y || pos.z < start.z ||
+                    pos.x > end.x || pos.y > end.y || pos.z > end.z) {
+                    continue;
+                }
+                for (const auto& value : values) {
+                    func(value);
+                }
+            }
+            return;
+        }
+        glm::ivec3 istart(start);
+        glm::ivec3 iend(end);
+        for (int y = istart.y; y <= iend.y; y++) {
+            for (int z = istart.z; z <= iend.z; z++) {
+                for (int x = istart.x; x <= iend.x; x++) {
+                    auto found = cells.find(glm::ivec3(x, y, z));
+                    if (found == cells.end()) {
+                        continue;
+                    }
+                    for (const auto& value : found->second) {
+                        func(value);
+                    }
+                }
+            }
+        }
+    }
+};
+
+#endif  // PHYSICS_SPATIAL_GRID_HPP_
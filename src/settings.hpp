@@ -39,6 +39,16 @@ struct ChunksSettings {
     IntegerSetting loadDistance {22, 3, 80};
     /// @brief Buffer zone where chunks are not unloading (chunk is unit)
     IntegerSetting padding {2, 1, 8};
+    /// @brief Max memory used by chunks kept in memory after unloading
+    /// to be reused (MiB)
+    IntegerSetting residentMemory {256, 0, 16384};
+    /// @brief Max scheduled block updates processed per blocks tick
+    IntegerSetting blockUpdates {1024, 16, 65536};
+    /// @brief Convert chunks saved with previous content indices when loaded
+    /// instead of converting the whole world before opening
+    FlagSetting lazyRemap {true};
+    /// @brief Convert the rest of a lazily converted world in background
+    FlagSetting remapInBackground {false};
 };
 
 struct CameraSettings {
@@ -64,6 +74,9 @@ struct GraphicsSettings {
     FlagSetting backlight {true};
     /// @brief Enable chunks frustum culling
     FlagSetting frustumCulling {true};
+    /// @brief Merge coplanar full block faces with the same texture and
+    /// lights into larger quads
+    FlagSetting greedyMeshing {false};
     IntegerSetting skyboxResolution {64 + 32, 64, 128};
 };
 
@@ -0,0 +1,184 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <exception>
+
+#include <debug/Logger.hpp>
+
+using namespace util;
+
+static debug::Logger logger("job-system");
+
+/// @brief Index of the current thread worker, -1 if not a worker thread
+static thread_local int current_worker = -1;
+static thread_local JobSystem* current_system = nullptr;
+
+JobSystem::JobSystem(uint threadsCount) {
+    for (uint i = 0; i < threadsCount; i++) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (uint i = 0; i < threadsCount; i++) {
+        threads.emplace_back(&JobSystem::threadLoop, this, i);
+    }
+    logger.info() << "started " << threadsCount << " workers";
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        working = false;
+    }
+    sleepCondition.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+JobSystem& JobSystem::getInstance() {
+    static JobSystem instance(
+        std::max(2u, std::thread::hardware_concurrency()) - 1
+    );
+    return instance;
+}
+
+void JobSystem::push(Job job, JobPriority priority) {
+    uint index;
+    if (current_system == this) {
+        index = current_worker;
+    } else {
+        index = nextQueue++ % queues.size();
+    }
+    {
+        auto& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs[static_cast<int>(priority)].push_back(std::move(job));
+    }
+    queued++;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    sleepCondition.notify_one();
+}
+
+bool JobSystem::pop(uint index, int priority, Job& job) {
+    auto& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    auto& jobs = queue.jobs[priority];
+    if (jobs.empty()) {
+        return false;
+    }
+    job = std::move(jobs.back());
+    jobs.pop_back();
+    return true;
+}
+
+bool JobSystem::steal(uint index, int priority, Job& job) {
+    for (size_t i = 1; i <= queues.size(); i++) {
+        auto& queue = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        auto& jobs = queue.jobs[priority];
+        if (jobs.empty()) {
+            continue;
+        }
+        job = std::move(jobs.front());
+        jobs.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::tryExecute(int index, JobPriority lowest) {
+    if (queued == 0) {
+        return false;
+    }
+    Job job;
+    for (int priority = 0; priority <= static_cast<int>(lowest); priority++) {
+        if ((index >= 0 && pop(index, priority, job)) ||
+            steal(std::max(index, 0), priority, job)) {
+            queued--;
+            execute(job);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(Job& job) {
+    try {
+        job.function();
+    } catch (const std::exception& err) {
+        logger.error() << "uncaught exception: " << err.what();
+    }
+    std::vector<JobState::Continuation> continuations;
+    {
+        std::lock_guard<std::mutex> lock(job.state->mutex);
+        job.state->done = true;
+        continuations = std::move(job.state->continuations);
+    }
+    for (auto& continuation : continuations) {
+        push(
+            Job {std::move(continuation.function), continuation.state},
+            continuation.priority
+        );
+    }
+}
+
+void JobSystem::threadLoop(uint index) {
+    current_worker = index;
+    current_system = this;
+    while (working) {
+        if (tryExecute(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [this] { return queued > 0 || !working; });
+    }
+}
+
+JobHandle JobSystem::submit(runnable function, JobPriority priority) {
+    auto state = std::make_shared<JobState>(priority);
+    push(Job {std::move(function), state}, priority);
+    return state;
+}
+
+JobHandle JobSystem::then(
+    const JobHandle& job, runnable function, JobPriority priority
+) {
+    auto state = std::make_shared<JobState>(priority);
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        if (!job->done) {
+            job->continuations.push_back(
+                JobState::Continuation {std::move(function), priority, state}
+            );
+            return state;
+        }
+    }
+    push(Job {std::move(function), state}, priority);
+    return state;
+}
+
+bool JobSystem::executeQueued(JobPriority lowest) {
+    int index = current_system == this ? current_worker : -1;
+    if (index < 0 && lowest == JobPriority::low) {
+        lowest = JobPriority::normal;
+    }
+    return tryExecute(index, lowest);
+}
+
+void JobSystem::wait(const JobHandle& job) {
+    int index = current_system == this ? current_worker : -1;
+    auto lowest = job->getPriority();
+    if (index < 0 && lowest == JobPriority::low) {
+        lowest = JobPriority::normal;
+    }
+    while (!job->isDone()) {
+        if (!tryExecute(index, lowest)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+uint JobSystem::getWorkersCount() const {
+    return threads.size();
+}
@@ -0,0 +1,117 @@
+#ifndef UTIL_JOB_SYSTEM_HPP_
+#define UTIL_JOB_SYSTEM_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <delegates.hpp>
+#include <typedefs.hpp>
+
+namespace util {
+    enum class JobPriority { high, normal, low };
+
+    inline constexpr int JOB_PRIORITIES = 3;
+
+    class JobSystem;
+
+    /// @brief Job completion state shared by the job system and handles
+    class JobState {
+        struct Continuation {
+            runnable function;
+            JobPriority priority;
+            std::shared_ptr<JobState> state;
+        };
+        std::mutex mutex;
+        std::atomic<bool> done = false;
+        std::vector<Continuation> continuations;
+        JobPriority priority;
+
+        friend class JobSystem;
+    public:
+        JobState(JobPriority priority) : priority(priority) {
+        }
+
+        bool isDone() const {
+            return done;
+        }
+
+        JobPriority getPriority() const {
+            return priority;
+        }
+    };
+
+    using JobHandle = std::shared_ptr<JobState>;
+
+    /// @brief Engine-wide set of worker threads executing short jobs.
+    /// Every worker has its own deque per priority: owner takes the newest
+    /// job, idle workers steal the oldest jobs from others.
+    /// Higher priority jobs are taken (or stolen) before lower priority ones
+    class JobSystem {
+        struct Job {
+            runnable function;
+            JobHandle state;
+        };
+        struct WorkerQueue {
+            std::mutex mutex;
+            std::deque<Job> jobs[JOB_PRIORITIES];
+        };
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+        std::vector<std::thread> threads;
+        std::mutex sleepMutex;
+        std::condition_variable sleepCondition;
+        std::atomic<uint> queued = 0;
+        std::atomic<uint> nextQueue = 0;
+        std::atomic<bool> working = true;
+
+        void push(Job job, JobPriority priority);
+        bool pop(uint index, int priority, Job& job);
+        bool steal(uint index, int priority, Job& job);
+        /// @brief Execute one job from the worker queue or stolen from
+        /// other workers
+        /// @param index worker index or -1 if called outside of workers
+        /// @param lowest lowest priority of jobs to execute
+        /// @return false if there is no jobs available
+        bool tryExecute(int index, JobPriority lowest = JobPriority::low);
+        void execute(Job& job);
+        void threadLoop(uint index);
+    public:
+        JobSystem(uint threadsCount);
+        ~JobSystem();
+
+        /// @brief Shared instance, created on first use with a worker per
+        /// hardware thread except the main one
+        static JobSystem& getInstance();
+
+        JobHandle submit(
+            runnable function, JobPriority priority = JobPriority::normal
+        );
+
+        /// @brief Submit continuation executed after the job is done
+        /// (immediately if already done)
+        /// @return continuation job handle
+        JobHandle then(
+            const JobHandle& job,
+            runnable function,
+            JobPriority priority = JobPriority::normal
+        );
+
+        /// @brief Execute one queued job of the priority or higher on the
+        /// calling thread. Low priority jobs are executed by workers only
+        /// @return false if there is no such jobs queued
+        bool executeQueued(JobPriority lowest);
+
+        /// @brief Wait for the job executing other jobs of the same or
+        /// higher priority meanwhile. Low priority jobs are executed by
+        /// workers only, so long background jobs never block other threads
+        void wait(const JobHandle& job);
+
+        uint getWorkersCount() const;
+    };
+}
+
+#endif  // UTIL_JOB_SYSTEM_HPP_
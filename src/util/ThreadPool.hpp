@@ -5,26 +5,19 @@
 #include <chrono>
 #include <condition_variable>
 #include <functional>
-#include <iostream>
+#include <mutex>
 #include <queue>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include <debug/Logger.hpp>
 #include <delegates.hpp>
 #include <interfaces/Task.hpp>
+#include "JobSystem.hpp"
 
 namespace util {
 
-    template <class J, class T>
-    struct ThreadPoolResult {
-        std::shared_ptr<J> job;
-        std::condition_variable& variable;
-        int workerIndex;
-        bool& locked;
-        T entry;
-    };
-
     template <class T, class R>
     class Worker {
     public:
@@ -33,19 +26,36 @@ namespace util {
         virtual R operator()(const std::shared_ptr<T>&) = 0;
     };
 
+    template <class J, class T>
+    struct ThreadPoolResult {
+        std::shared_ptr<J> job;
+        /// @brief worker is not reused until the result is consumed if
+        /// results are not standalone
+        std::shared_ptr<Worker<J, T>> worker;
+        T entry;
+    };
+
+    /// @brief Queue of jobs processed by stateful workers on JobSystem
+    /// threads. Pool has a worker per JobSystem thread, every worker is
+    /// used by one job at time
     template <class T, class R>
     class ThreadPool : public Task {
         debug::Logger logger;
+        JobSystem& jobSystem;
         std::queue<std::shared_ptr<T>> jobs;
         std::queue<ThreadPoolResult<T, R>> results;
-        std::mutex resultsMutex;
-        std::vector<std::thread> threads;
-        std::condition_variable jobsMutexCondition;
-        std::mutex jobsMutex;
-        std::vector<std::unique_lock<std::mutex>> workersBlocked;
+        std::vector<std::shared_ptr<Worker<T, R>>> freeWorkers;
+        /// @brief guards jobs, results and freeWorkers
+        mutable std::mutex mutex;
+        /// @brief notified when scheduled becomes zero
+        std::condition_variable idleCondition;
         consumer<R&> resultConsumer;
         consumer<std::shared_ptr<T>&> onJobFailed = nullptr;
         runnable onComplete = nullptr;
+        JobPriority priority = JobPriority::normal;
+        uint workersCount;
+        /// @brief JobSystem jobs submitted and not finished yet
+        uint scheduled = 0;
         std::atomic<int> busyWorkers = 0;
         std::atomic<uint> jobsDone = 0;
         std::atomic<bool> working = true;
@@ -53,55 +63,70 @@ namespace util {
         bool standaloneResults = true;
         bool stopOnFail = true;
 
-        void threadLoop(int index, std::shared_ptr<Worker<T, R>> worker) {
-            std::condition_variable variable;
-            std::mutex mutex;
-            bool locked = false;
-            while (working) {
-                std::shared_ptr<T> job;
-                {
-                    std::unique_lock<std::mutex> lock(jobsMutex);
-                    jobsMutexCondition.wait(lock, [this] {
-                        return !jobs.empty() || !working;
-                    });
-                    if (!working || failed) {
-                        break;
-                    }
+        /// @brief Submit JobSystem jobs for free workers. Mutex must be
+        /// locked
+        void schedule() {
+            while (working && !failed && scheduled < freeWorkers.size() &&
+                   scheduled < jobs.size()) {
+                scheduled++;
+                jobSystem.submit([this]() { runNext(); }, priority);
+            }
+        }
+
+        void runNext() {
+            std::shared_ptr<T> job;
+            std::shared_ptr<Worker<T, R>> worker;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (working && !failed && !jobs.empty() &&
+                    !freeWorkers.empty()) {
                     job = jobs.front();
                     jobs.pop();
-
+                    worker = freeWorkers.back();
+                    freeWorkers.pop_back();
                     busyWorkers++;
                 }
-                try {
-                    R result = (*worker)(job);
-                    {
-                        std::lock_guard<std::mutex> lock(resultsMutex);
-                        results.push(ThreadPoolResult<T, R> {
-                            job, variable, index, locked, result});
-                        if (!standaloneResults) {
-                            locked = true;
-                        }
-                        busyWorkers--;
-                    }
-                    if (!standaloneResults) {
-                        std::unique_lock<std::mutex> lock(mutex);
-                        variable.wait(lock, [&] {
-                            return !working || !locked;
-                        });
-                    }
-                } catch (std::exception& err) {
+            }
+            if (job) {
+                process(job, worker);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            scheduled--;
+            schedule();
+            if (scheduled == 0) {
+                idleCondition.notify_all();
+            }
+        }
+
+        void process(
+            const std::shared_ptr<T>& job,
+            const std::shared_ptr<Worker<T, R>>& worker
+        ) {
+            try {
+                R result = (*worker)(job);
+                std::lock_guard<std::mutex> lock(mutex);
+                results.push(ThreadPoolResult<T, R> {job, worker, result});
+                if (standaloneResults) {
+                    freeWorkers.push_back(worker);
+                }
+                busyWorkers--;
+            } catch (std::exception& err) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    freeWorkers.push_back(worker);
                     busyWorkers--;
-                    if (onJobFailed) {
-                        onJobFailed(job);
-                    }
-                    if (stopOnFail) {
-                        std::lock_guard<std::mutex> lock(jobsMutex);
-                        failed = true;
-                    }
-                    logger.error() << "uncaught exception: " << err.what();
                 }
-                jobsDone++;
+                if (onJobFailed) {
+                    std::shared_ptr<T> failedJob = job;
+                    onJobFailed(failedJob);
+                }
+                if (stopOnFail) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    failed = true;
+                }
+                logger.error() << "uncaught exception: " << err.what();
             }
+            jobsDone++;
         }
     public:
         ThreadPool(
@@ -109,13 +134,12 @@ namespace util {
             supplier<std::shared_ptr<Worker<T, R>>> workersSupplier,
             consumer<R&> resultConsumer
         )
-            : logger(std::move(name)), resultConsumer(resultConsumer) {
-            const uint num_threads = std::thread::hardware_concurrency();
-            for (uint i = 0; i < num_threads; i++) {
-                threads.emplace_back(
-                    &ThreadPool<T, R>::threadLoop, this, i, workersSupplier()
-                );
-                workersBlocked.emplace_back();
+            : logger(std::move(name)),
+              jobSystem(JobSystem::getInstance()),
+              resultConsumer(resultConsumer),
+              workersCount(jobSystem.getWorkersCount()) {
+            for (uint i = 0; i < workersCount; i++) {
+                freeWorkers.push_back(workersSupplier());
             }
         }
         ~ThreadPool() {
@@ -126,30 +150,16 @@ namespace util {
             return working;
         }
 
+        /// @brief Drop queued jobs and results, wait for running jobs
         void terminate() override {
             if (!working) {
                 return;
             }
-            {
-                std::lock_guard<std::mutex> lock(jobsMutex);
-                working = false;
-            }
-            {
-                std::lock_guard<std::mutex> lock(resultsMutex);
-                while (!results.empty()) {
-                    ThreadPoolResult<T, R> entry = results.front();
-                    results.pop();
-                    if (!standaloneResults) {
-                        entry.locked = false;
-                        entry.variable.notify_all();
-                    }
-                }
-            }
-
-            jobsMutexCondition.notify_all();
-            for (auto& thread : threads) {
-                thread.join();
-            }
+            std::unique_lock<std::mutex> lock(mutex);
+            working = false;
+            jobs = {};
+            results = {};
+            idleCondition.wait(lock, [this] { return scheduled == 0; });
         }
 
         void update() override {
@@ -160,59 +170,59 @@ namespace util {
                 throw std::runtime_error("some job failed");
             }
 
-            bool complete = false;
+            std::queue<ThreadPoolResult<T, R>> ready;
             {
-                std::lock_guard<std::mutex> lock(resultsMutex);
-                while (!results.empty()) {
-                    ThreadPoolResult<T, R> entry = results.front();
-                    results.pop();
+                std::lock_guard<std::mutex> lock(mutex);
+                std::swap(ready, results);
+            }
+            while (!ready.empty()) {
+                ThreadPoolResult<T, R> entry = std::move(ready.front());
+                ready.pop();
 
-                    try {
-                        resultConsumer(entry.entry);
-                    } catch (std::exception& err) {
-                        logger.error() << err.what();
-                        if (onJobFailed) {
-                            onJobFailed(entry.job);
-                        }
-                        if (stopOnFail) {
-                            std::lock_guard<std::mutex> jobsLock(jobsMutex);
-                            failed = true;
-                            complete = false;
-                        }
-                        break;
+                try {
+                    resultConsumer(entry.entry);
+                } catch (std::exception& err) {
+                    logger.error() << err.what();
+                    if (onJobFailed) {
+                        onJobFailed(entry.job);
                     }
-
-                    if (!standaloneResults) {
-                        entry.locked = false;
-                        entry.variable.notify_all();
+                    if (stopOnFail) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        failed = true;
                     }
+                    break;
                 }
 
-                if (onComplete && busyWorkers == 0) {
-                    std::lock_guard<std::mutex> jobsLock(jobsMutex);
-                    if (jobs.empty()) {
-                        onComplete();
-                        complete = true;
-                    }
+                if (!standaloneResults) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    freeWorkers.push_back(entry.worker);
+                    schedule();
                 }
             }
             if (failed) {
                 throw std::runtime_error("some job failed");
             }
+
+            bool complete = false;
+            if (onComplete) {
+                std::lock_guard<std::mutex> lock(mutex);
+                complete =
+                    busyWorkers == 0 && jobs.empty() && results.empty();
+            }
             if (complete) {
+                onComplete();
                 terminate();
             }
         }
 
         void enqueueJob(const std::shared_ptr<T>& job) {
-            {
-                std::lock_guard<std::mutex> lock(jobsMutex);
-                jobs.push(job);
-            }
-            jobsMutexCondition.notify_one();
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push(job);
+            schedule();
         }
 
-        /// @brief If false: worker will be blocked until it's result performed
+        /// @brief If false: worker will not take next job until it's result
+        /// performed
         void setStandaloneResults(bool flag) {
             standaloneResults = flag;
         }
@@ -221,6 +231,11 @@ namespace util {
             stopOnFail = flag;
         }
 
+        /// @brief Priority of the pool jobs in JobSystem
+        void setPriority(JobPriority priority) {
+            this->priority = priority;
+        }
+
         /// @brief onJobFailed called on exception thrown in worker thread.
         /// Use engine.postRunnable when calling terminate()
         void setOnJobFailed(consumer<T&> callback) {
@@ -234,6 +249,7 @@ namespace util {
         }
 
         uint getWorkTotal() const override {
+            std::lock_guard<std::mutex> lock(mutex);
             return jobs.size() + jobsDone + busyWorkers;
         }
 
@@ -250,7 +266,7 @@ namespace util {
         }
 
         uint getWorkersCount() const {
-            return threads.size();
+            return workersCount;
         }
     };
 
@@ -7,6 +7,11 @@
 #include <lighting/Lightmap.hpp>
 #include "voxel.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CHUNK_SIMD_PLANES
+#endif
+
 Chunk::Chunk(int xpos, int zpos) : x(xpos), z(zpos) {
     bottom = 0;
     top = CHUNK_H;
@@ -90,8 +95,79 @@ std::unique_ptr<Chunk> Chunk::clone() const {
 
     Total size: (CHUNK_VOL * 4) bytes
 */
+#ifdef CHUNK_SIMD_PLANES
+// voxel bytes are: id low, id high, state low, state high
+// (little-endian with bit-fields allocated from the lowest bit)
+
+/// @brief Split 16 voxels into four 16 bytes planes
+static inline void split_planes(const voxel* src, ubyte* dst) {
+    auto in = reinterpret_cast<const __m128i*>(src);
+    __m128i a = _mm_loadu_si128(in);
+    __m128i b = _mm_loadu_si128(in + 1);
+    __m128i c = _mm_loadu_si128(in + 2);
+    __m128i d = _mm_loadu_si128(in + 3);
+    // three byte interleaving rounds transpose 4x4 bytes of every voxel
+    for (int i = 0; i < 2; i++) {
+        __m128i t0 = _mm_unpacklo_epi8(a, b);
+        __m128i t1 = _mm_unpackhi_epi8(a, b);
+        __m128i t2 = _mm_unpacklo_epi8(c, d);
+        __m128i t3 = _mm_unpackhi_epi8(c, d);
+        a = t0, b = t1, c = t2, d = t3;
+    }
+    __m128i w0 = _mm_unpacklo_epi8(a, b);  // bytes 0 and 1 of voxels 0-7
+    __m128i w1 = _mm_unpackhi_epi8(a, b);  // bytes 2 and 3 of voxels 0-7
+    __m128i w2 = _mm_unpacklo_epi8(c, d);  // bytes 0 and 1 of voxels 8-15
+    __m128i w3 = _mm_unpackhi_epi8(c, d);  // bytes 2 and 3 of voxels 8-15
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(dst), _mm_unpackhi_epi64(w0, w2)
+    );
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(dst + CHUNK_VOL),
+        _mm_unpacklo_epi64(w0, w2)
+    );
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(dst + CHUNK_VOL * 2),
+        _mm_unpackhi_epi64(w1, w3)
+    );
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(dst + CHUNK_VOL * 3),
+        _mm_unpacklo_epi64(w1, w3)
+    );
+}
+
+/// @brief Merge four 16 bytes planes into 16 voxels
+static inline void merge_planes(const ubyte* src, voxel* dst) {
+    __m128i idHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    __m128i idLow = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(src + CHUNK_VOL)
+    );
+    __m128i stateHigh = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(src + CHUNK_VOL * 2)
+    );
+    __m128i stateLow = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(src + CHUNK_VOL * 3)
+    );
+    __m128i ids0 = _mm_unpacklo_epi8(idLow, idHigh);
+    __m128i ids1 = _mm_unpackhi_epi8(idLow, idHigh);
+    __m128i states0 = _mm_unpacklo_epi8(stateLow, stateHigh);
+    __m128i states1 = _mm_unpackhi_epi8(stateLow, stateHigh);
+    auto out = reinterpret_cast<__m128i*>(dst);
+    _mm_storeu_si128(out, _mm_unpacklo_epi16(ids0, states0));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(ids0, states0));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(ids1, states1));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(ids1, states1));
+}
+
+static_assert(CHUNK_VOL % 16 == 0);
+#endif
+
 std::unique_ptr<ubyte[]> Chunk::encode() const {
     auto buffer = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
+#ifdef CHUNK_SIMD_PLANES
+    for (uint i = 0; i < CHUNK_VOL; i += 16) {
+        split_planes(voxels + i, buffer.get() + i);
+    }
+#else
     for (uint i = 0; i < CHUNK_VOL; i++) {
         buffer[i] = voxels[i].id >> 8;
         buffer[CHUNK_VOL + i] = voxels[i].id & 0xFF;
@@ -100,10 +176,17 @@ std::unique_ptr<ubyte[]> Chunk::encode() const {
         buffer[CHUNK_VOL * 2 + i] = state >> 8;
         buffer[CHUNK_VOL * 3 + i] = state & 0xFF;
     }
+#endif
     return buffer;
 }
 
 bool Chunk::decode(const ubyte* data) {
+    tickables.reset();
+#ifdef CHUNK_SIMD_PLANES
+    for (uint i = 0; i < CHUNK_VOL; i += 16) {
+        merge_planes(data + i, voxels + i);
+    }
+#else
     for (uint i = 0; i < CHUNK_VOL; i++) {
         voxel& vox = voxels[i];
 
@@ -120,6 +203,7 @@ bool Chunk::decode(const ubyte* data) {
             static_cast<blockstate_t>(bst2)
         );
     }
+#endif
     return true;
 }
 
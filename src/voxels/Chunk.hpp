@@ -3,11 +3,14 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include <constants.hpp>
 #include <lighting/Lightmap.hpp>
+#include "ChunkSections.hpp"
 #include "voxel.hpp"
 
 inline constexpr int CHUNK_DATA_LEN = CHUNK_VOL * 4;
@@ -23,6 +26,26 @@ namespace dynamic {
 using chunk_inventories_map =
     std::unordered_map<uint, std::shared_ptr<Inventory>>;
 
+static_assert(CHUNK_VOL <= 0x10000);
+
+/// @brief Indices of blocks having random update handler, by sections
+struct RandomTickIndex {
+    std::vector<uint16_t> sections[CHUNK_SECTIONS];
+
+    void add(uint index) {
+        sections[index / CHUNK_SECTION_VOL].push_back(index);
+    }
+
+    void remove(uint index) {
+        auto& indices = sections[index / CHUNK_SECTION_VOL];
+        auto found = std::find(indices.begin(), indices.end(), index);
+        if (found != indices.end()) {
+            *found = indices.back();
+            indices.pop_back();
+        }
+    }
+};
+
 class Chunk {
 public:
     int x, z;
@@ -42,6 +65,10 @@ public:
     /// @brief Block inventories map where key is index of block in voxels array
     chunk_inventories_map inventories;
 
+    /// @brief Built on the first random tick, kept up to date by
+    /// Chunks::set and reset by decode
+    std::unique_ptr<RandomTickIndex> tickables;
+
     Chunk(int x, int z);
 
     bool isEmpty();
@@ -0,0 +1,114 @@
+#include "ChunkSections.hpp"
+
+#include <unordered_map>
+
+#include "Chunk.hpp"
+
+inline uint32_t voxel2int(voxel vox) {
+    return static_cast<uint32_t>(vox.id) |
+           static_cast<uint32_t>(blockstate2int(vox.state)) << 16;
+}
+
+/// @return min number of bits required to store palette index
+inline ubyte bits_for(size_t paletteSize) {
+    ubyte bits = 1;
+    while ((1ULL << bits) < paletteSize) {
+        bits++;
+    }
+    return bits;
+}
+
+PalettedSection::PalettedSection(uint32_t value) : palette({value}) {
+}
+
+void PalettedSection::setBits(ubyte newBits) {
+    bits = newBits;
+    valuesPerWord = 64 / bits;
+    words.assign((CHUNK_SECTION_VOL + valuesPerWord - 1) / valuesPerWord, 0);
+}
+
+void PalettedSection::setIndex(uint index, uint32_t paletteIndex) {
+    uint64_t& word = words[index / valuesPerWord];
+    uint shift = (index % valuesPerWord) * bits;
+    uint64_t mask = ((1ULL << bits) - 1) << shift;
+    word = (word & ~mask) | (static_cast<uint64_t>(paletteIndex) << shift);
+}
+
+PalettedSection PalettedSection::encode(const uint32_t* values) {
+    PalettedSection section(values[0]);
+    std::unordered_map<uint32_t, uint32_t> indices {{values[0], 0}};
+    for (uint i = 1; i < CHUNK_SECTION_VOL; i++) {
+        if (indices.find(values[i]) == indices.end()) {
+            indices[values[i]] = section.palette.size();
+            section.palette.push_back(values[i]);
+        }
+    }
+    if (section.palette.size() == 1) {
+        return section;
+    }
+    section.setBits(bits_for(section.palette.size()));
+    uint32_t prevValue = values[0];
+    uint32_t prevIndex = 0;
+    for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+        // neighbour voxels are often the same
+        if (values[i] != prevValue) {
+            prevValue = values[i];
+            prevIndex = indices[prevValue];
+        }
+        section.setIndex(i, prevIndex);
+    }
+    return section;
+}
+
+void PalettedSection::decode(uint32_t* dst) const {
+    for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+        dst[i] = get(i);
+    }
+}
+
+size_t PalettedSection::getMemoryUsage() const {
+    return palette.capacity() * sizeof(uint32_t) +
+           words.capacity() * sizeof(uint64_t);
+}
+
+ChunkSections::ChunkSections(const Chunk& chunk) {
+    auto values = std::make_unique<uint32_t[]>(CHUNK_SECTION_VOL);
+    const light_t* lightmap = chunk.lightmap.getLights();
+    for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        const uint offset = s * CHUNK_SECTION_VOL;
+        for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+            values[i] = voxel2int(chunk.voxels[offset + i]);
+        }
+        voxels[s] = PalettedSection::encode(values.get());
+        for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+            values[i] = lightmap[offset + i];
+        }
+        lights[s] = PalettedSection::encode(values.get());
+    }
+}
+
+void ChunkSections::decode(Chunk& chunk) const {
+    auto values = std::make_unique<uint32_t[]>(CHUNK_SECTION_VOL);
+    light_t* lightmap = chunk.lightmap.getLightsWriteable();
+    for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        const uint offset = s * CHUNK_SECTION_VOL;
+        voxels[s].decode(values.get());
+        for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+            chunk.voxels[offset + i] = voxel {
+                static_cast<blockid_t>(values[i] & 0xFFFF),
+                int2blockstate(values[i] >> 16)};
+        }
+        lights[s].decode(values.get());
+        for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+            lightmap[offset + i] = values[i];
+        }
+    }
+}
+
+size_t ChunkSections::getMemoryUsage() const {
+    size_t size = sizeof(ChunkSections);
+    for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        size += voxels[s].getMemoryUsage() + lights[s].getMemoryUsage();
+    }
+    return size;
+}
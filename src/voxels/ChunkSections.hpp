@@ -0,0 +1,65 @@
+#ifndef VOXELS_CHUNK_SECTIONS_HPP_
+#define VOXELS_CHUNK_SECTIONS_HPP_
+
+#include <memory>
+#include <vector>
+
+#include <constants.hpp>
+#include <typedefs.hpp>
+
+class Chunk;
+
+inline constexpr int CHUNK_SECTION_H = 16;
+inline constexpr int CHUNK_SECTIONS = CHUNK_H / CHUNK_SECTION_H;
+inline constexpr int CHUNK_SECTION_VOL = CHUNK_W * CHUNK_SECTION_H * CHUNK_D;
+
+static_assert(CHUNK_H % CHUNK_SECTION_H == 0);
+
+/// @brief Palette-encoded array of CHUNK_SECTION_VOL values.
+/// Uniform section stores the only palette entry, mixed section stores
+/// palette indices of the minimal bit width packed into 64 bit words
+class PalettedSection {
+    std::vector<uint32_t> palette;
+    std::vector<uint64_t> words;
+    ubyte bits = 0;
+    ubyte valuesPerWord = 0;
+
+    void setBits(ubyte bits);
+    void setIndex(uint index, uint32_t paletteIndex);
+    uint32_t getIndex(uint index) const {
+        uint64_t word = words[index / valuesPerWord];
+        uint shift = (index % valuesPerWord) * bits;
+        return (word >> shift) & ((1ULL << bits) - 1);
+    }
+public:
+    PalettedSection(uint32_t value = 0);
+
+    /// @brief Encode CHUNK_SECTION_VOL values
+    static PalettedSection encode(const uint32_t* values);
+
+    /// @brief Decode all values to dst array of CHUNK_SECTION_VOL length
+    void decode(uint32_t* dst) const;
+
+    uint32_t get(uint index) const {
+        return bits == 0 ? palette[0] : palette[getIndex(index)];
+    }
+
+    /// @brief Get heap memory used by the section in bytes
+    size_t getMemoryUsage() const;
+};
+
+/// @brief Compact chunk voxels and lights split into vertical sections
+class ChunkSections {
+    PalettedSection voxels[CHUNK_SECTIONS];
+    PalettedSection lights[CHUNK_SECTIONS];
+public:
+    ChunkSections(const Chunk& chunk);
+
+    /// @brief Write voxels and lights to the chunk
+    void decode(Chunk& chunk) const;
+
+    /// @brief Get memory used by the sections in bytes
+    size_t getMemoryUsage() const;
+};
+
+#endif  // VOXELS_CHUNK_SECTIONS_HPP_
@@ -96,6 +96,56 @@ const AABB* Chunks::isObstacleAt(float x, float y, float z) {
     return nullptr;
 }
 
+void Chunks::getColliders(const AABB& area, std::vector<AABB>& dst) {
+    glm::ivec3 start = glm::floor(area.min());
+    glm::ivec3 end = glm::floor(area.max());
+    // one layer of solid cells is enough to hold bodies above the bottom
+    start.y = std::max(start.y, -1);
+    end.y = std::min(end.y, CHUNK_H - 1);
+
+    int lastcx = INT_MIN;
+    int lastcz = INT_MIN;
+    Chunk* chunk = nullptr;
+    for (int z = start.z; z <= end.z; z++) {
+        for (int x = start.x; x <= end.x; x++) {
+            int cx = floordiv(x, CHUNK_W);
+            int cz = floordiv(z, CHUNK_D);
+            if (cx != lastcx || cz != lastcz) {
+                chunk = getChunk(cx, cz);
+                lastcx = cx;
+                lastcz = cz;
+            }
+            int lx = x - cx * CHUNK_W;
+            int lz = z - cz * CHUNK_D;
+            for (int y = start.y; y <= end.y; y++) {
+                if (chunk == nullptr || y < 0) {
+                    dst.emplace_back(
+                        glm::vec3(x, y, z), glm::vec3(x + 1, y + 1, z + 1)
+                    );
+                    continue;
+                }
+                const voxel& vox = chunk->voxels[vox_index(lx, y, lz)];
+                const auto& def = indices->blocks.require(vox.id);
+                if (!def.obstacle) {
+                    continue;
+                }
+                glm::vec3 origin(x, y, z);
+                if (vox.state.segment) {
+                    origin = seekOrigin({x, y, z}, def, vox.state);
+                }
+                const auto& boxes = def.rotatable
+                                        ? def.rt.hitboxes[vox.state.rotation]
+                                        : def.hitboxes;
+                for (const auto& hitbox : boxes) {
+                    dst.emplace_back(
+                        origin + hitbox.min(), origin + hitbox.max()
+                    );
+                }
+            }
+        }
+    }
+}
+
 bool Chunks::isSolidBlock(int32_t x, int32_t y, int32_t z) {
     voxel* v = get(x, y, z);
     if (v == nullptr) return false;
@@ -349,7 +399,12 @@ void Chunks::setRotation(int32_t x, int32_t y, int32_t z, uint8_t index) {
 }
 
 void Chunks::set(
-    int32_t x, int32_t y, int32_t z, uint32_t id, blockstate state
+    int32_t x,
+    int32_t y,
+    int32_t z,
+    uint32_t id,
+    blockstate state,
+    bool updateHeights
 ) {
     if (y < 0 || y >= CHUNK_H) {
         return;
@@ -386,6 +441,15 @@ void Chunks::set(
     vox.id = id;
     vox.state = state;
     chunk->setModifiedAndUnsaved();
+    if (chunk->tickables &&
+        prevdef.rt.funcsset.randupdate != newdef.rt.funcsset.randupdate) {
+        uint index = vox_index(lx, y, lz);
+        if (newdef.rt.funcsset.randupdate) {
+            chunk->tickables->add(index);
+        } else {
+            chunk->tickables->remove(index);
+        }
+    }
     if (!state.segment && newdef.rt.extended) {
         repairSegments(newdef, state, gx, y, gz);
     }
@@ -394,7 +458,7 @@ void Chunks::set(
         chunk->bottom = y;
     else if (y + 1 > chunk->top)
         chunk->top = y + 1;
-    else if (id == 0)
+    else if (id == 0 && updateHeights)
         chunk->updateHeights();
 
     if (lx == 0 && (chunk = getChunk(cx + ox - 1, cz + oz)))
@@ -662,8 +726,9 @@ void Chunks::translate(int32_t dx, int32_t dz) {
             if (chunk == nullptr) continue;
             if (nx < 0 || nz < 0 || nx >= static_cast<int>(w) ||
                 nz >= static_cast<int>(d)) {
-                level->events->trigger(EVT_CHUNK_HIDDEN, chunk.get());
+                // saved first to release the chunk with actual flags
                 save(chunk.get());
+                level->events->trigger(EVT_CHUNK_HIDDEN, chunk.get());
                 chunksCount--;
                 continue;
             }
@@ -674,6 +739,7 @@ void Chunks::translate(int32_t dx, int32_t dz) {
 
     ox += dx;
     oz += dz;
+    revision++;
 }
 
 void Chunks::resize(uint32_t newW, uint32_t newD) {
@@ -704,6 +770,7 @@ void Chunks::resize(uint32_t newW, uint32_t newD) {
     volume = newVolume;
     chunks = std::move(newChunks);
     chunksSecond = std::move(newChunksSecond);
+    revision++;
 }
 
 void Chunks::_setOffset(int32_t x, int32_t z) {
@@ -732,6 +799,7 @@ void Chunks::saveAndClear() {
         save(chunk);
     }
     chunksCount = 0;
+    revision++;
 }
 
 void Chunks::save(Chunk* chunk) {
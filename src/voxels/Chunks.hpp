@@ -39,6 +39,8 @@ public:
     size_t volume;
     size_t chunksCount;
     size_t visible = 0;
+    /// @brief Incremented when chunks are moved or removed from the matrix
+    uint64_t revision = 0;
     uint32_t w, d;
     int32_t ox, oz;
     WorldFiles* worldFiles;
@@ -65,7 +67,16 @@ public:
 
     light_t getLight(int32_t x, int32_t y, int32_t z);
     ubyte getLight(int32_t x, int32_t y, int32_t z, int channel);
-    void set(int32_t x, int32_t y, int32_t z, uint32_t id, blockstate state);
+    /// @param updateHeights if false, chunk bottom/top are only extended,
+    /// call Chunk::updateHeights after a batch of edits
+    void set(
+        int32_t x,
+        int32_t y,
+        int32_t z,
+        uint32_t id,
+        blockstate state,
+        bool updateHeights = true
+    );
 
     /// @brief Seek for the extended block origin position
     /// @param pos segment block position
@@ -100,6 +111,12 @@ public:
     glm::vec3 rayCastToObstacle(glm::vec3 start, glm::vec3 dir, float maxDist);
 
     const AABB* isObstacleAt(float x, float y, float z);
+
+    /// @brief Collect world-space hitboxes of obstacles in the area.
+    /// Unloaded chunks and the area below the world are solid
+    /// @param area the area
+    /// @param dst destination vector
+    void getColliders(const AABB& area, std::vector<AABB>& dst);
     bool isSolidBlock(int32_t x, int32_t y, int32_t z);
     bool isReplaceableBlock(int32_t x, int32_t y, int32_t z);
     bool isObstacleBlock(int32_t x, int32_t y, int32_t z);
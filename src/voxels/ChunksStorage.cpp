@@ -1,26 +1,63 @@
 #include "ChunksStorage.hpp"
 
 #include <content/Content.hpp>
+#include <data/dynamic.hpp>
 #include <debug/Logger.hpp>
 #include <files/WorldFiles.hpp>
 #include <items/Inventories.hpp>
+#include <items/Inventory.hpp>
 #include <lighting/Lightmap.hpp>
 #include <maths/voxmaths.hpp>
 #include <objects/Entities.hpp>
 #include <typedefs.hpp>
+#include <util/JobSystem.hpp>
 #include <world/Level.hpp>
 #include <world/World.hpp>
 #include "Block.hpp"
 #include "Chunk.hpp"
+#include "ChunkSections.hpp"
 #include "VoxelsVolume.hpp"
 
 static debug::Logger logger("chunks-storage");
 
+/// @brief Sections encoded by a job, shared with the job as the entry
+/// may be evicted before the job is done
+struct EncodedSections {
+    std::unique_ptr<ChunkSections> sections;
+};
+
+struct ReleasedChunk {
+    std::shared_ptr<EncodedSections> encoded;
+    /// @brief Encoding job, keeps the chunk alive until done
+    util::JobHandle job;
+    decltype(Chunk::flags) flags;
+    chunk_inventories_map inventories;
+    std::list<glm::ivec2>::iterator node;
+    /// @brief Whole chunk size until encoded
+    size_t memoryUsage = sizeof(Chunk);
+
+    ReleasedChunk(std::shared_ptr<Chunk> chunk)
+        : encoded(std::make_shared<EncodedSections>()),
+          flags(chunk->flags),
+          inventories(chunk->inventories) {
+        // chunk is not modified since removed from the matrix
+        job = util::JobSystem::getInstance().submit(
+            [encoded = encoded, chunk = std::move(chunk)]() {
+                encoded->sections = std::make_unique<ChunkSections>(*chunk);
+            }
+        );
+    }
+};
+
 ChunksStorage::ChunksStorage(Level* level) : level(level) {
 }
 
+ChunksStorage::~ChunksStorage() = default;
+
 void ChunksStorage::store(const std::shared_ptr<Chunk>& chunk) {
-    chunksMap[glm::ivec2(chunk->x, chunk->z)] = chunk;
+    glm::ivec2 key(chunk->x, chunk->z);
+    chunksMap[key] = chunk;
+    removeReleased(key);
 }
 
 std::shared_ptr<Chunk> ChunksStorage::get(int x, int z) const {
@@ -32,10 +69,122 @@ std::shared_ptr<Chunk> ChunksStorage::get(int x, int z) const {
 }
 
 void ChunksStorage::remove(int x, int z) {
-    auto found = chunksMap.find(glm::ivec2(x, z));
+    glm::ivec2 key(x, z);
+    auto found = chunksMap.find(key);
     if (found != chunksMap.end()) {
-        chunksMap.erase(found->first);
+        for (auto& entry : found->second->inventories) {
+            level->inventories->remove(entry.second->getId());
+        }
+        chunksMap.erase(found);
+    }
+    removeReleased(key);
+}
+
+void ChunksStorage::removeReleased(const glm::ivec2& key) {
+    auto found = released.find(key);
+    if (found == released.end()) {
+        return;
+    }
+    releaseOrder.erase(found->second->node);
+    releasedBytes -= found->second->memoryUsage;
+    encoding.erase(key);
+    released.erase(found);
+}
+
+void ChunksStorage::updateEncoded() {
+    for (auto it = encoding.begin(); it != encoding.end();) {
+        auto& entry = *released.at(*it);
+        if (!entry.job->isDone()) {
+            ++it;
+            continue;
+        }
+        // failed job leaves the whole chunk size to be evicted soon
+        if (auto& sections = entry.encoded->sections) {
+            releasedBytes -= entry.memoryUsage;
+            entry.memoryUsage = sections->getMemoryUsage();
+            releasedBytes += entry.memoryUsage;
+        }
+        it = encoding.erase(it);
+    }
+}
+
+void ChunksStorage::release(int x, int z) {
+    glm::ivec2 key(x, z);
+    auto found = chunksMap.find(key);
+    if (found == chunksMap.end()) {
+        return;
+    }
+    auto chunk = std::move(found->second);
+    chunksMap.erase(found);
+    for (auto& entry : chunk->inventories) {
+        level->inventories->remove(entry.second->getId());
+    }
+    if (memoryBudget == 0) {
+        return;
+    }
+    auto entry = std::make_unique<ReleasedChunk>(std::move(chunk));
+    releaseOrder.push_front(key);
+    entry->node = releaseOrder.begin();
+    releasedBytes += entry->memoryUsage;
+    released[key] = std::move(entry);
+    encoding.insert(key);
+    evict();
+}
+
+void ChunksStorage::evict() {
+    updateEncoded();
+    while (!releaseOrder.empty() && releasedBytes > memoryBudget) {
+        removeReleased(releaseOrder.back());
+    }
+}
+
+std::shared_ptr<Chunk> ChunksStorage::acquire(
+    int x, int z, dynamic::Map_sptr& entities
+) {
+    glm::ivec2 key(x, z);
+    auto found = released.find(key);
+    if (found == released.end()) {
+        return nullptr;
+    }
+    auto& entry = *found->second;
+    if (!entry.job->isDone()) {
+        util::JobSystem::getInstance().wait(entry.job);
+    }
+    if (entry.encoded->sections == nullptr) {
+        removeReleased(key);
+        return nullptr;
+    }
+    auto chunk = std::make_shared<Chunk>(x, z);
+    entry.encoded->sections->decode(*chunk);
+    chunk->flags = entry.flags;
+    // saved on release unless not lighted: regions skip such chunks,
+    // so their changes are still unsaved
+    chunk->flags.unsaved = entry.flags.unsaved && !entry.flags.lighted;
+    chunk->flags.modified = true;
+    chunk->inventories = std::move(entry.inventories);
+    chunk->updateHeights();
+    removeReleased(key);
+
+    // entities were unloaded and saved with the chunk
+    if (chunk->flags.entities) {
+        auto& regions = level->getWorld()->wfile->getRegions();
+        entities = regions.fetchEntities(x, z);
     }
+    return chunk;
+}
+
+void ChunksStorage::setMemoryBudget(size_t budget) {
+    memoryBudget = budget;
+    evict();
+}
+
+size_t ChunksStorage::getResidentCount() const {
+    return chunksMap.size() + released.size();
+}
+
+size_t ChunksStorage::getResidentBytes() const {
+    // voxels and lightmap of stored chunks are inline
+    return chunksMap.size() * sizeof(Chunk) + releasedBytes;
 }
 
 static void verifyLoadedChunk(ContentIndices* indices, Chunk* chunk) {
@@ -51,12 +200,13 @@ static void verifyLoadedChunk(ContentIndices* indices, Chunk* chunk) {
     }
 }
 
-std::shared_ptr<Chunk> ChunksStorage::create(int x, int z) {
+std::shared_ptr<Chunk> ChunksStorage::read(
+    int x, int z, dynamic::Map_sptr& entities
+) const {
     World* world = level->getWorld();
     auto& regions = world->wfile.get()->getRegions();
 
     auto chunk = std::make_shared<Chunk>(x, z);
-    store(chunk);
     auto data = regions.getChunk(chunk->x, chunk->z);
     if (data) {
         chunk->decode(data.get());
@@ -64,15 +214,11 @@ std::shared_ptr<Chunk> ChunksStorage::create(int x, int z) {
         auto invs = regions.fetchInventories(chunk->x, chunk->z);
         chunk->setBlockInventories(std::move(invs));
 
-        if (auto map = regions.fetchEntities(chunk->x, chunk->z)) {
-            level->entities->loadEntities(std::move(map));
+        if ((entities = regions.fetchEntities(chunk->x, chunk->z))) {
             chunk->flags.entities = true;
         }
 
         chunk->flags.loaded = true;
-        for (auto& entry : chunk->inventories) {
-            level->inventories->store(entry.second);
-        }
         verifyLoadedChunk(level->content->getIndices(), chunk.get());
     }
 
@@ -84,6 +230,25 @@ std::shared_ptr<Chunk> ChunksStorage::create(int x, int z) {
     return chunk;
 }
 
+void ChunksStorage::install(
+    const std::shared_ptr<Chunk>& chunk, dynamic::Map_sptr entities
+) {
+    store(chunk);
+    if (entities) {
+        level->entities->loadEntities(std::move(entities));
+    }
+    for (auto& entry : chunk->inventories) {
+        level->inventories->store(entry.second);
+    }
+}
+
+std::shared_ptr<Chunk> ChunksStorage::create(int x, int z) {
+    dynamic::Map_sptr entities;
+    auto chunk = read(x, z, entities);
+    install(chunk, std::move(entities));
+    return chunk;
+}
+
 // reduce nesting on next modification
 // 25.06.2024: not now
 void ChunksStorage::getVoxels(VoxelsVolume* volume, bool backlight) const {
@@ -1,9 +1,12 @@
 #ifndef VOXELS_CHUNKSSTORAGE_HPP_
 #define VOXELS_CHUNKSSTORAGE_HPP_
 
+#include <list>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
+#include <data/dynamic_fwd.hpp>
 #include <typedefs.hpp>
 #include "voxel.hpp"
 
@@ -13,18 +16,67 @@
 class Chunk;
 class Level;
 class VoxelsVolume;
+struct ReleasedChunk;
 
 class ChunksStorage {
     Level* level;
     std::unordered_map<glm::ivec2, std::shared_ptr<Chunk>> chunksMap;
+    /// @brief Compressed chunks released from the matrix
+    std::unordered_map<glm::ivec2, std::unique_ptr<ReleasedChunk>> released;
+    /// @brief Released chunks positions, most recently released first
+    std::list<glm::ivec2> releaseOrder;
+    /// @brief Released chunks being compressed in background
+    std::unordered_set<glm::ivec2> encoding;
+    /// @brief Max memory used by released chunks in bytes
+    size_t memoryBudget = 0;
+    size_t releasedBytes = 0;
+
+    void removeReleased(const glm::ivec2& key);
+    /// @brief Account memory of released chunks compressed since the
+    /// last call
+    void updateEncoded();
+    /// @brief Remove least recently released chunks while over budget
+    void evict();
 public:
     ChunksStorage(Level* level);
-    ~ChunksStorage() = default;
+    ~ChunksStorage();
 
     std::shared_ptr<Chunk> get(int x, int z) const;
     void store(const std::shared_ptr<Chunk>& chunk);
     void remove(int x, int y);
+
+    /// @brief Compress chunk removed from the matrix in background and
+    /// keep it until evicted. Chunk must be saved already
+    void release(int x, int z);
+
+    /// @brief Take released chunk back for use in the matrix
+    /// @param entities (out argument) saved chunk entities or nullptr
+    /// @return new chunk or nullptr if not resident
+    std::shared_ptr<Chunk> acquire(int x, int z, dynamic::Map_sptr& entities);
+
+    /// @param budget max memory used by released chunks in bytes
+    void setMemoryBudget(size_t budget);
+
+    /// @brief Get number of stored chunks including released ones
+    size_t getResidentCount() const;
+    /// @brief Get approximate memory used by stored and released chunks
+    /// in bytes
+    size_t getResidentBytes() const;
     void getVoxels(VoxelsVolume* volume, bool backlight = false) const;
+
+    /// @brief Read chunk voxels, inventories and lights from world regions
+    /// without registering the chunk. Safe to call from worker threads
+    /// @param entities (out argument) saved chunk entities or nullptr
+    std::shared_ptr<Chunk> read(
+        int x, int z, dynamic::Map_sptr& entities
+    ) const;
+
+    /// @brief Register chunk created with read(...): store it and load
+    /// its inventories and entities into the level (main thread only)
+    void install(
+        const std::shared_ptr<Chunk>& chunk, dynamic::Map_sptr entities
+    );
+
     std::shared_ptr<Chunk> create(int x, int z);
 };
 
@@ -11,8 +11,14 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/noise.hpp>
 #include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_map>
 #include <vector>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
 
 #include <content/Content.hpp>
 #include <core_defs.hpp>
@@ -39,7 +45,7 @@ public:
         for (int i = 0; i < MAPS_LEN; i++) delete[] heights[i];
     }
 
-    inline float get(MAPS map, int x, int z) {
+    inline float get(MAPS map, int x, int z) const {
         x -= this->x;
         z -= this->z;
         if (x < 0 || z < 0 || x >= w || z >= d) {
@@ -56,8 +62,64 @@ public:
         }
         heights[(int)map][z * w + x] = value;
     }
+
+    inline bool contains(int x, int z) const {
+        x -= this->x;
+        z -= this->z;
+        return x >= 0 && z >= 0 && x < w && z < d;
+    }
+};
+
+/// @brief Terrain maps of a single chunk columns
+struct ChunkColumns {
+    float maps[MAPS_LEN][CHUNK_W * CHUNK_D];
+};
+
+/// @brief Columns of recently generated chunks. Generated chunk requires
+/// padded maps, so most of the columns are shared with neighbour chunks.
+/// Shared by generators of all loader workers
+class ColumnsCache {
+    std::mutex mutex;
+    size_t capacity;
+    /// @brief Keys in order of use, most recently used first
+    std::list<glm::ivec3> order;
+    std::unordered_map<
+        glm::ivec3,
+        std::pair<std::shared_ptr<const ChunkColumns>,
+                  std::list<glm::ivec3>::iterator>>
+        entries;
+public:
+    ColumnsCache(size_t capacity) : capacity(capacity) {
+    }
+
+    /// @param key noise seed, chunk x, chunk z
+    std::shared_ptr<const ChunkColumns> get(const glm::ivec3& key) {
+        std::lock_guard lock(mutex);
+        auto found = entries.find(key);
+        if (found == entries.end()) {
+            return nullptr;
+        }
+        order.splice(order.begin(), order, found->second.second);
+        return found->second.first;
+    }
+
+    void put(const glm::ivec3& key, std::shared_ptr<const ChunkColumns> data) {
+        std::lock_guard lock(mutex);
+        if (entries.find(key) != entries.end()) {
+            return;
+        }
+        order.push_front(key);
+        entries[key] = {std::move(data), order.begin()};
+        if (entries.size() > capacity) {
+            entries.erase(order.back());
+            order.pop_back();
+        }
+    }
 };
 
+/// @brief 4 KiB per entry
+static ColumnsCache columns_cache(1024);
+
 float calc_height(fnl_state* noise, int cur_x, int cur_z) {
     float height = 0;
 
@@ -97,53 +159,182 @@ float calc_height(fnl_state* noise, int cur_x, int cur_z) {
     return height;
 }
 
-int generate_tree(
-    fnl_state* noise,
-    PseudoRandom* random,
-    Map2D& heights,
-    //   Map2D& humidity,
-    int cur_x,
-    int cur_y,
-    int cur_z,
-    int tileSize,
-    blockid_t idWood,
-    blockid_t idLeaves
+/// @brief Terrain maps view for features placement
+class MapTerrainQuery : public TerrainQuery {
+    const Map2D& heights;
+public:
+    MapTerrainQuery(const Map2D& heights) : heights(heights) {
+    }
+
+    float getHeight(int x, int z) const override {
+        return heights.get(MAPS::HEIGHT, x, z);
+    }
+
+    float getVegetation(int x, int z) const override {
+        return heights.get(MAPS::TREE, x, z);
+    }
+};
+
+/// @brief At most one tree per square tile. Tree is cut by its tile bounds
+class TreeFeature : public WorldFeature {
+    int tileSize;
+    blockid_t idWood;
+    blockid_t idLeaves;
+public:
+    TreeFeature(int tileSize, blockid_t idWood, blockid_t idLeaves)
+        : tileSize(tileSize), idWood(idWood), idLeaves(idLeaves) {
+    }
+
+    void place(
+        int x1,
+        int z1,
+        int x2,
+        int z2,
+        int seed,
+        const TerrainQuery& terrain,
+        std::vector<FeaturePlacement>& dst
+    ) const override {
+        PseudoRandom random;
+        for (int tileZ = floordiv(z1, tileSize);
+             tileZ <= floordiv(z2, tileSize);
+             tileZ++) {
+            for (int tileX = floordiv(x1, tileSize);
+                 tileX <= floordiv(x2, tileSize);
+                 tileX++) {
+                random.setSeed(
+                    tileX * 4325261 + tileZ * 12160951 + tileSize * 9431111
+                );
+                int randomX = (random.rand() % (tileSize / 2)) - tileSize / 4;
+                int randomZ = (random.rand() % (tileSize / 2)) - tileSize / 4;
+
+                int centerX = tileX * tileSize + tileSize / 2 + randomX;
+                int centerZ = tileZ * tileSize + tileSize / 2 + randomZ;
+
+                bool gentree = (random.rand() % 10) <
+                               terrain.getVegetation(centerX, centerZ) * 13;
+                if (!gentree) continue;
+
+                int height = (int)(terrain.getHeight(centerX, centerZ));
+                if (height < SEA_LEVEL + 1) continue;
+                int radius = random.rand() % 4 + 2;
+                dst.push_back(
+                    {this, glm::ivec3(centerX, height, centerZ), radius}
+                );
+            }
+        }
+    }
+
+    void rasterize(const FeaturePlacement& placement, GeneratedChunk& chunk)
+        const override {
+        const glm::ivec3& center = placement.origin;
+        const int radius = placement.size;
+        const int tileX = floordiv(center.x, tileSize);
+        const int tileZ = floordiv(center.z, tileSize);
+        const int x1 = std::max(center.x - radius, tileX * tileSize);
+        const int z1 = std::max(center.z - radius, tileZ * tileSize);
+        const int x2 = std::min(center.x + radius, (tileX + 1) * tileSize - 1);
+        const int z2 = std::min(center.z + radius, (tileZ + 1) * tileSize - 1);
+        blockstate state {};
+        state.rotation = BLOCK_DIR_UP;
+        // leaves ellipsoid is 3 * radius above the surface
+        const int y2 = center.y + 5 * radius;
+        for (int y = center.y; y <= y2; y++) {
+            int ly = y - center.y - 3 * radius;
+            for (int z = z1; z <= z2; z++) {
+                int lz = z - center.z;
+                for (int x = x1; x <= x2; x++) {
+                    int lx = x - center.x;
+                    if (lx == 0 && lz == 0 &&
+                        y - center.y < (3 * radius + radius / 2)) {
+                        chunk.place(x, y, z, idWood, state);
+                    } else if (lx * lx + ly * ly / 2 + lz * lz <
+                               radius * radius) {
+                        chunk.place(x, y, z, idLeaves, state);
+                    }
+                }
+            }
+        }
+    }
+};
+
+DefaultWorldGenerator::DefaultWorldGenerator(const Content* content)
+    : WorldGenerator(content) {
+    addFeature(std::make_shared<TreeFeature>(12, idWood, idLeaves));
+}
+
+static std::unique_ptr<ChunkColumns> calc_columns(
+    fnl_state* noise, int cx, int cz
 ) {
-    const int tileX = floordiv(cur_x, tileSize);
-    const int tileZ = floordiv(cur_z, tileSize);
-
-    random->setSeed(tileX * 4325261 + tileZ * 12160951 + tileSize * 9431111);
-
-    int randomX = (random->rand() % (tileSize / 2)) - tileSize / 4;
-    int randomZ = (random->rand() % (tileSize / 2)) - tileSize / 4;
-
-    int centerX = tileX * tileSize + tileSize / 2 + randomX;
-    int centerZ = tileZ * tileSize + tileSize / 2 + randomZ;
-
-    bool gentree =
-        (random->rand() % 10) < heights.get(MAPS::TREE, centerX, centerZ) * 13;
-    if (!gentree) return 0;
-
-    int height = (int)(heights.get(MAPS::HEIGHT, centerX, centerZ));
-    if (height < SEA_LEVEL + 1) return 0;
-    int lx = cur_x - centerX;
-    int radius = random->rand() % 4 + 2;
-    int ly = cur_y - height - 3 * radius;
-    int lz = cur_z - centerZ;
-    if (lx == 0 && lz == 0 && cur_y - height < (3 * radius + radius / 2))
-        return idWood;
-    if (lx * lx + ly * ly / 2 + lz * lz < radius * radius) return idLeaves;
-    return 0;
+    auto columns = std::make_unique<ChunkColumns>();
+    for (int z = 0; z < CHUNK_D; z++) {
+        const int cur_z = z + cz * CHUNK_D;
+        float* heights = &columns->maps[(int)MAPS::HEIGHT][z * CHUNK_W];
+        float* trees = &columns->maps[(int)MAPS::TREE][z * CHUNK_W];
+        float* sands = &columns->maps[(int)MAPS::SAND][z * CHUNK_W];
+        float* cliffs = &columns->maps[(int)MAPS::CLIFF][z * CHUNK_W];
+        // every map is calculated for the whole row at once
+        for (int x = 0; x < CHUNK_W; x++) {
+            heights[x] = calc_height(noise, x + cx * CHUNK_W, cur_z);
+        }
+        for (int x = 0; x < CHUNK_W; x++) {
+            const int cur_x = x + cx * CHUNK_W;
+            trees[x] = fnlGetNoise2D(noise, cur_x * 0.3 + 633, cur_z * 0.3);
+            sands[x] =
+                fnlGetNoise2D(noise, cur_x * 0.1 - 633, cur_z * 0.1 + 1000);
+        }
+        for (int x = 0; x < CHUNK_W; x++) {
+            float height = heights[x];
+            float sand = sands[x];
+            float cliff = pow((sand + abs(sand)) / 2, 2);
+            float w = pow(fmax(-abs(height - SEA_LEVEL) + 4, 0) / 6, 2) * cliff;
+            float h1 = -abs(height - SEA_LEVEL - 0.03);
+            float h2 = abs(height - SEA_LEVEL + 0.04);
+            float h = (h1 + h2) * 100;
+            heights[x] = height + (h * w);
+            cliffs[x] = cliff;
+        }
+    }
+    return columns;
+}
+
+/// @brief Copy columns of the chunk and its neighbours overlapping the map
+static void fill_map(fnl_state* noise, Map2D& map, int cx, int cz) {
+    for (int ncz = cz - 1; ncz <= cz + 1; ncz++) {
+        for (int ncx = cx - 1; ncx <= cx + 1; ncx++) {
+            glm::ivec3 key(noise->seed, ncx, ncz);
+            auto columns = columns_cache.get(key);
+            if (columns == nullptr) {
+                columns = calc_columns(noise, ncx, ncz);
+                columns_cache.put(key, columns);
+            }
+            for (int z = 0; z < CHUNK_D; z++) {
+                for (int x = 0; x < CHUNK_W; x++) {
+                    int cur_x = x + ncx * CHUNK_W;
+                    int cur_z = z + ncz * CHUNK_D;
+                    if (!map.contains(cur_x, cur_z)) {
+                        continue;
+                    }
+                    for (int i = 0; i < MAPS_LEN; i++) {
+                        map.set(
+                            static_cast<MAPS>(i),
+                            cur_x,
+                            cur_z,
+                            columns->maps[i][z * CHUNK_W + x]
+                        );
+                    }
+                }
+            }
+        }
+    }
 }
 
 void DefaultWorldGenerator::generate(voxel* voxels, int cx, int cz, int seed) {
-    const int treesTile = 12;
     fnl_state noise = fnlCreateState();
     noise.noise_type = FNL_NOISE_OPENSIMPLEX2;
     noise.seed = seed * 60617077 % 25896307;
-    PseudoRandom randomtree;
     PseudoRandom randomgrass;
 
+    // must not exceed chunk size: only direct neighbours columns are used
     int padding = 8;
     Map2D heights(
         cx * CHUNK_W - padding,
@@ -151,27 +342,7 @@ void DefaultWorldGenerator::generate(voxel* voxels, int cx, int cz, int seed) {
         CHUNK_W + padding * 2,
         CHUNK_D + padding * 2
     );
-
-    for (int z = -padding; z < CHUNK_D + padding; z++) {
-        for (int x = -padding; x < CHUNK_W + padding; x++) {
-            int cur_x = x + cx * CHUNK_W;
-            int cur_z = z + cz * CHUNK_D;
-            float height = calc_height(&noise, cur_x, cur_z);
-            float hum = fnlGetNoise2D(&noise, cur_x * 0.3 + 633, cur_z * 0.3);
-            float sand =
-                fnlGetNoise2D(&noise, cur_x * 0.1 - 633, cur_z * 0.1 + 1000);
-            float cliff = pow((sand + abs(sand)) / 2, 2);
-            float w = pow(fmax(-abs(height - SEA_LEVEL) + 4, 0) / 6, 2) * cliff;
-            float h1 = -abs(height - SEA_LEVEL - 0.03);
-            float h2 = abs(height - SEA_LEVEL + 0.04);
-            float h = (h1 + h2) * 100;
-            height += (h * w);
-            heights.set(MAPS::HEIGHT, cur_x, cur_z, height);
-            heights.set(MAPS::TREE, cur_x, cur_z, hum);
-            heights.set(MAPS::SAND, cur_x, cur_z, sand);
-            heights.set(MAPS::CLIFF, cur_x, cur_z, cliff);
-        }
-    }
+    fill_map(&noise, heights, cx, cz);
 
     for (int z = 0; z < CHUNK_D; z++) {
         int cur_z = z + cz * CHUNK_D;
@@ -189,22 +360,6 @@ void DefaultWorldGenerator::generate(voxel* voxels, int cx, int cz, int seed) {
                     id = idStone;
                 } else if (cur_y < height) {
                     id = idDirt;
-                } else {
-                    int tree = generate_tree(
-                        &noise,
-                        &randomtree,
-                        heights,
-                        cur_x,
-                        cur_y,
-                        cur_z,
-                        treesTile,
-                        idWood,
-                        idLeaves
-                    );
-                    if (tree) {
-                        id = tree;
-                        state.rotation = BLOCK_DIR_UP;
-                    }
                 }
                 float sand = fmax(
                     heights.get(MAPS::SAND, cur_x, cur_z),
@@ -238,4 +393,5 @@ void DefaultWorldGenerator::generate(voxel* voxels, int cx, int cz, int seed) {
             }
         }
     }
+    generateFeatures(voxels, cx, cz, seed, MapTerrainQuery(heights));
 }
@@ -9,8 +9,7 @@ class Content;
 
 class DefaultWorldGenerator : WorldGenerator {
 public:
-    DefaultWorldGenerator(const Content* content) : WorldGenerator(content) {
-    }
+    DefaultWorldGenerator(const Content* content);
 
     void generate(voxel* voxels, int x, int z, int seed);
 };
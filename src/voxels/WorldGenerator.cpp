@@ -5,8 +5,35 @@
 #include "Chunk.hpp"
 #include "voxel.hpp"
 
+GeneratedChunk::GeneratedChunk(
+    voxel* voxels, int cx, int cz, const Content* content
+)
+    : voxels(voxels),
+      cx(cx),
+      cz(cz),
+      blocks(content->getIndices()->blocks.getDefs()) {
+}
+
+void GeneratedChunk::place(
+    int x, int y, int z, blockid_t id, blockstate state
+) {
+    x -= cx * CHUNK_W;
+    z -= cz * CHUNK_D;
+    if (x < 0 || y < 0 || z < 0 || x >= CHUNK_W || y >= CHUNK_H ||
+        z >= CHUNK_D) {
+        return;
+    }
+    voxel& vox = voxels[vox_index(x, y, z)];
+    if (!blocks[vox.id]->replaceable) {
+        return;
+    }
+    vox.id = id;
+    vox.state = state;
+}
+
 WorldGenerator::WorldGenerator(const Content* content)
-    : idStone(content->blocks.require("base:stone").rt.id),
+    : content(content),
+      idStone(content->blocks.require("base:stone").rt.id),
       idDirt(content->blocks.require("base:dirt").rt.id),
       idGrassBlock(content->blocks.require("base:grass_block").rt.id),
       idSand(content->blocks.require("base:sand").rt.id),
@@ -17,3 +44,28 @@ WorldGenerator::WorldGenerator(const Content* content)
       idFlower(content->blocks.require("base:flower").rt.id),
       idBazalt(content->blocks.require("base:bazalt").rt.id) {
 }
+
+void WorldGenerator::addFeature(std::shared_ptr<WorldFeature> feature) {
+    features.push_back(std::move(feature));
+}
+
+void WorldGenerator::generateFeatures(
+    voxel* voxels, int cx, int cz, int seed, const TerrainQuery& terrain
+) {
+    GeneratedChunk chunk(voxels, cx, cz, content);
+    for (const auto& feature : features) {
+        placements.clear();
+        feature->place(
+            cx * CHUNK_W,
+            cz * CHUNK_D,
+            (cx + 1) * CHUNK_W - 1,
+            (cz + 1) * CHUNK_D - 1,
+            seed,
+            terrain,
+            placements
+        );
+        for (const auto& placement : placements) {
+            feature->rasterize(placement, chunk);
+        }
+    }
+}
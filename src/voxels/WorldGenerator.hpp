@@ -1,15 +1,95 @@
 #ifndef VOXELS_WORLDGENERATOR_HPP_
 #define VOXELS_WORLDGENERATOR_HPP_
 
+#include <glm/glm.hpp>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <typedefs.hpp>
+#include "voxel.hpp"
 
-struct voxel;
 class Content;
+class Block;
+class WorldFeature;
+
+/// @brief Generated terrain available to features placement
+class TerrainQuery {
+public:
+    virtual ~TerrainQuery() = default;
+
+    /// @return surface height of the column
+    virtual float getHeight(int x, int z) const = 0;
+
+    /// @return vegetation density of the column in [-1, 1] range
+    virtual float getVegetation(int x, int z) const = 0;
+};
+
+/// @brief Feature structure instance selected for a chunk
+struct FeaturePlacement {
+    const WorldFeature* feature;
+    /// @brief World position the structure is built from
+    glm::ivec3 origin;
+    /// @brief Feature-specific structure size
+    int size;
+};
+
+/// @brief Voxels of a chunk being generated
+class GeneratedChunk {
+    voxel* voxels;
+    int cx;
+    int cz;
+    const Block* const* blocks;
+public:
+    GeneratedChunk(voxel* voxels, int cx, int cz, const Content* content);
+
+    /// @brief Set voxel at the world position if it is inside of the chunk
+    /// and the current block is replaceable
+    void place(int x, int y, int z, blockid_t id, blockstate state = {});
+
+    int getX() const {
+        return cx;
+    }
+
+    int getZ() const {
+        return cz;
+    }
+};
+
+/// @brief Structure type placed over the generated terrain (trees etc.).
+/// Placements are selected once per chunk, then rasterized to the chunk
+/// voxels. Must not change own state: a feature may be shared between
+/// generators used by different loader workers
+class WorldFeature {
+public:
+    virtual ~WorldFeature() = default;
+
+    /// @brief Find structures which voxels may intersect the area
+    /// @param x1 min area x
+    /// @param z1 min area z
+    /// @param x2 max area x (inclusive)
+    /// @param z2 max area z (inclusive)
+    virtual void place(
+        int x1,
+        int z1,
+        int x2,
+        int z2,
+        int seed,
+        const TerrainQuery& terrain,
+        std::vector<FeaturePlacement>& dst
+    ) const = 0;
+
+    /// @brief Write the structure voxels to the chunk
+    virtual void rasterize(
+        const FeaturePlacement& placement, GeneratedChunk& chunk
+    ) const = 0;
+};
 
 class WorldGenerator {
+    std::vector<std::shared_ptr<WorldFeature>> features;
+    std::vector<FeaturePlacement> placements;
 protected:
+    const Content* const content;
     blockid_t const idStone;
     blockid_t const idDirt;
     blockid_t const idGrassBlock;
@@ -20,11 +100,20 @@ protected:
     blockid_t const idGrass;
     blockid_t const idFlower;
     blockid_t const idBazalt;
+
+    /// @brief Place all registered features over the generated terrain
+    void generateFeatures(
+        voxel* voxels, int cx, int cz, int seed, const TerrainQuery& terrain
+    );
 public:
     WorldGenerator(const Content* content);
     virtual ~WorldGenerator() = default;
 
     virtual void generate(voxel* voxels, int x, int z, int seed) = 0;
+
+    /// @brief Register feature placed by generateFeatures in order of
+    /// registration
+    void addFeature(std::shared_ptr<WorldFeature> feature);
 };
 
 #endif  // VOXELS_WORLDGENERATOR_HPP_
@@ -63,9 +63,12 @@ Level::Level(
         matrixSize, matrixSize, 0, 0, world->wfile.get(), this
     );
     lighting = std::make_unique<Lighting>(content, chunks.get());
+    chunksStorage->setMemoryBudget(
+        static_cast<size_t>(settings.chunks.residentMemory.get()) << 20
+    );
 
     events->listen(EVT_CHUNK_HIDDEN, [this](lvl_event_type, Chunk* chunk) {
-        this->chunksStorage->remove(chunk->x, chunk->z);
+        this->chunksStorage->release(chunk->x, chunk->z);
     });
 
     inventories = std::make_unique<Inventories>(*this);
@@ -8,6 +8,7 @@
 #include <content/ContentLUT.hpp>
 #include <debug/Logger.hpp>
 #include <files/WorldFiles.hpp>
+#include <files/WorldRemap.hpp>
 #include <items/Inventories.hpp>
 #include <objects/Entities.hpp>
 #include <objects/Player.hpp>
@@ -123,6 +124,16 @@ std::unique_ptr<Level> World::load(
     }
     wfile->readResourcesData(content);
 
+    auto& regions = wfile->getRegions();
+    try {
+        regions.setRemap(WorldRemap::read(regions.getRemapFile(), content));
+    } catch (const std::runtime_error& err) {
+        throw world_load_error(err.what());
+    }
+    if (settings.chunks.remapInBackground.get()) {
+        regions.convergeRemap();
+    }
+
     auto level = std::make_unique<Level>(std::move(world), content, settings);
     {
         fs::path file = wfile->getPlayerFile();
@@ -158,10 +169,24 @@ std::shared_ptr<ContentLUT> World::checkIndices(
     const fs::path& directory, const Content* content
 ) {
     fs::path indicesFile = directory / fs::path("indices.json");
+    std::shared_ptr<ContentLUT> lut;
     if (fs::is_regular_file(indicesFile)) {
-        return ContentLUT::create(indicesFile, content);
+        lut = ContentLUT::create(indicesFile, content);
+    }
+    if (lut && lut->hasMissingContent()) {
+        return lut;
+    }
+    // lazily converted chunks may refer to removed content too
+    std::unique_ptr<WorldRemap> remap;
+    try {
+        remap = WorldRemap::read(directory / fs::path("remap.json"), content);
+    } catch (const std::runtime_error& err) {
+        throw world_load_error(err.what());
+    }
+    if (remap && remap->getLUT() && remap->getLUT()->hasMissingContent()) {
+        return remap->getLUT();
     }
-    return nullptr;
+    return lut;
 }
 
 void World::setName(const std::string& name) {
@@ -74,10 +74,12 @@ public:
     /// @brief Write all unsaved level data to the world directory
     void write(Level* level);
 
-    /// @brief Check world indices and generate ContentLUT if convert required
+    /// @brief Check world indices and generate ContentLUT if convert required.
+    /// Indices of lazily converted chunks are checked for missing content
     /// @param directory world directory
     /// @param content current Content instance
     /// @return ContentLUT if world convert required else nullptr
+    /// @throws world_load_error if remap.json is malformed
     static std::shared_ptr<ContentLUT> checkIndices(
         const fs::path& directory, const Content* content
     );